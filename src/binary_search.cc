@@ -1,44 +1,1509 @@
 #include <iostream>
 #include <vector>
+#include <deque>
+#include <set>
+#include <string>
 #include <algorithm>
+#include <functional>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <type_traits>
+#include <limits>
+#include <cmath>
+#include <thread>
+#include <iterator>
+#include <numeric>
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <cstdlib>
+#include <map>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SEARCH_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SEARCH_X86_SIMD 1
+#include <immintrin.h>
+#endif
 
 #define CATCH_CONFIG_MAIN
 #include <catch.hpp>
 
-using namespace std;
+using namespace std;
+
+// the original three-way compare loop, kept around as the benchmark baseline
+int binary_search2_branchy(const vector<int> &a, const int &x) {
+  int start = 0, end = a.size();
+  while (start < end) {
+    int middle = (start + end) / 2;
+    int val = a[middle];
+    if (val == x) {
+      return middle;
+    } else if (val > x) {
+      end = middle;
+    } else {
+      start = middle + 1;
+    }
+  }
+  return -1;
+}
+
+inline void prefetch(const void *p) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(p);
+#else
+  (void)p;
+#endif
+}
+
+// Branchless lower_bound: the range only ever shrinks from the top, the base
+// moves forward by `half` or by 0, which the compiler turns into a cmov.
+// Both candidate midpoints of the next step are prefetched, so the load for
+// the next iteration is already in flight while this compare resolves.
+template<typename T, typename K, typename Compare = less<T>>
+size_t branchless_lower_bound(const T *first, const size_t &n, const K &x, Compare comp = Compare()) {
+  if (n == 0) return 0;
+  const T *base = first;
+  size_t len = n;
+  while (len > 1) {
+    size_t half = len / 2;
+    size_t next = (len - half) / 2;
+    prefetch(base + next);
+    prefetch(base + half + next);
+    base += comp(base[half - 1], x) ? half : 0;
+    len -= half;
+  }
+  return (base - first) + comp(*base, x);
+}
+
+template<typename T, typename K, typename Compare = less<T>>
+size_t branchless_upper_bound(const T *first, const size_t &n, const K &x, Compare comp = Compare()) {
+  if (n == 0) return 0;
+  const T *base = first;
+  size_t len = n;
+  while (len > 1) {
+    size_t half = len / 2;
+    size_t next = (len - half) / 2;
+    prefetch(base + next);
+    prefetch(base + half + next);
+    base += comp(x, base[half - 1]) ? 0 : half;
+    len -= half;
+  }
+  return (base - first) + !comp(x, *base);
+}
+
+template<typename T, typename Compare = less<T>>
+size_t branchless_lower_bound(const vector<T> &a, const T &x, Compare comp = Compare()) {
+  return branchless_lower_bound(a.data(), a.size(), x, comp);
+}
+
+template<typename T, typename Compare = less<T>>
+size_t branchless_upper_bound(const vector<T> &a, const T &x, Compare comp = Compare()) {
+  return branchless_upper_bound(a.data(), a.size(), x, comp);
+}
+
+template<typename T, typename Compare = less<T>>
+pair<size_t, size_t> branchless_equal_range(const vector<T> &a, const T &x, Compare comp = Compare()) {
+  return make_pair(branchless_lower_bound(a, x, comp), branchless_upper_bound(a, x, comp));
+}
+
+int binary_search2(const vector<int> &a, const int &x) {
+  size_t i = branchless_lower_bound(a, x);
+  return (i < a.size() && a[i] == x) ? int(i) : -1;
+}
+
+//
+// Generic versions over any random-access range, key type and comparator.
+// The vector<int> overloads above stay the fast path for plain ints; these
+// return iterators or size_t positions so nothing is truncated at 2^31.
+//
+
+// a miss, for the size_t returning versions
+const size_t not_found = size_t(-1);
+
+// true for iterators whose elements sit next to each other in memory, the
+// ones that can take the prefetching pointer loop
+template<typename It, typename V = typename iterator_traits<It>::value_type>
+struct is_contiguous_iterator
+: integral_constant<bool, is_pointer<It>::value ||
+                          (!is_same<V, bool>::value &&
+                           (is_same<It, typename vector<V>::iterator>::value ||
+                            is_same<It, typename vector<V>::const_iterator>::value))> {};
+
+template<typename RandomIt, typename K, typename Compare>
+RandomIt branchless_lower_bound(RandomIt first, RandomIt last, const K &x, Compare comp, true_type) {
+  return first + branchless_lower_bound(&*first, size_t(last - first), x, comp);
+}
+
+template<typename RandomIt, typename K, typename Compare>
+RandomIt branchless_lower_bound(RandomIt first, RandomIt last, const K &x, Compare comp, false_type) {
+  auto len = last - first;
+  while (len > 1) {
+    auto half = len / 2;
+    first += comp(first[half - 1], x) ? half : 0;
+    len -= half;
+  }
+  return first + (len == 1 && comp(*first, x));
+}
+
+template<typename RandomIt, typename K, typename Compare = less<>>
+RandomIt branchless_lower_bound(RandomIt first, RandomIt last, const K &x, Compare comp = Compare()) {
+  if (first == last) return first;
+  return branchless_lower_bound(first, last, x, comp, is_contiguous_iterator<RandomIt>());
+}
+
+// iterator to an element equivalent to x, last on a miss
+template<typename RandomIt, typename K, typename Compare = less<>>
+RandomIt binary_search2(RandomIt first, RandomIt last, const K &x, Compare comp = Compare()) {
+  RandomIt it = branchless_lower_bound(first, last, x, comp);
+  return (it != last && !comp(x, *it)) ? it : last;
+}
+
+// position of an element equivalent to x, not_found on a miss
+template<typename Range, typename K, typename Compare = less<>>
+size_t binary_search2(const Range &a, const K &x, Compare comp = Compare()) {
+  auto first = begin(a), last = end(a);
+  auto it = binary_search2(first, last, x, comp);
+  return it == last ? not_found : size_t(it - first);
+}
+
+template<typename RandomIt, typename K, typename Compare>
+size_t binary_search_rec(RandomIt base, const K &x, Compare &comp, const size_t &start, const size_t &end) {
+  if (start >= end) return not_found;
+  size_t middle = start + (end - start) / 2;
+  if (comp(x, base[middle])) {
+    return binary_search_rec(base, x, comp, start, middle);
+  } else if (comp(base[middle], x)) {
+    return binary_search_rec(base, x, comp, middle + 1, end);
+  }
+  return middle;
+}
+
+// binary_search's recursive halving, position of x or not_found
+template<typename Range, typename K, typename Compare = less<>>
+size_t binary_search(const Range &a, const K &x, Compare comp = Compare()) {
+  return binary_search_rec(begin(a), x, comp, 0, size_t(end(a) - begin(a)));
+}
+
+int binary_search(const vector<int> &a, const int &x) {
+  less<int> comp;
+  size_t i = binary_search_rec(a.data(), x, comp, 0, a.size());
+  return i == not_found ? -1 : int(i);
+}
+
+// Batched lookups: the keys are searched in groups that advance in lockstep.
+// All searches over one array halve the same length at the same time, so a
+// group just keeps one base pointer per key, and the probes of one round are
+// independent loads that the memory system can serve in parallel instead of
+// one cache miss after another. Results follow binary_search2.
+template<typename T, size_t Group = 32>
+void binary_search_batch(const vector<T> &a, const T *keys, const size_t &count, int *out) {
+  const size_t n = a.size();
+  for (size_t start = 0; start < count; start += Group) {
+    const size_t m = min(Group, count - start);
+    const T *key = keys + start;
+    if (n == 0) {
+      fill(out + start, out + start + m, -1);
+      continue;
+    }
+    const T *base[Group];
+    fill(base, base + m, a.data());
+    size_t len = n;
+    while (len > 1) {
+      size_t half = len / 2;
+      size_t next = (len - half) / 2;
+      for (size_t j = 0; j < m; ++j) {
+        base[j] += base[j][half - 1] < key[j] ? half : 0;
+        prefetch(base[j] + next);
+      }
+      len -= half;
+    }
+    for (size_t j = 0; j < m; ++j) {
+      size_t i = (base[j] - a.data()) + (*base[j] < key[j]);
+      out[start + j] = (i < n && a[i] == key[j]) ? int(i) : -1;
+    }
+  }
+}
+
+// Keys that arrive in ascending order: every search starts where the last
+// one ended and gallops forward (1, 2, 4, ... elements) before bisecting the
+// bracketed window, O(m log(n / m)) for m keys instead of O(m log n).
+template<typename T>
+void binary_search_sorted(const vector<T> &a, const T *keys, const size_t &count, int *out) {
+  const size_t n = a.size();
+  size_t lo = 0;
+  for (size_t j = 0; j < count; ++j) {
+    const T &x = keys[j];
+    size_t hi = lo, step = 1;
+    // everything before lo is less than x
+    while (hi < n && a[hi] < x) {
+      lo = hi + 1;
+      hi += step;
+      step *= 2;
+    }
+    lo = lower_bound(a.begin() + lo, a.begin() + min(hi, n), x) - a.begin();
+    out[j] = (lo < n && a[lo] == x) ? int(lo) : -1;
+  }
+}
+
+// picks the galloping sweep when the keys happen to be sorted
+template<typename T>
+vector<int> binary_search_batch(const vector<T> &a, const vector<T> &keys) {
+  vector<int> out(keys.size());
+  if (is_sorted(keys.begin(), keys.end())) {
+    binary_search_sorted(a, keys.data(), keys.size(), out.data());
+  } else {
+    binary_search_batch(a, keys.data(), keys.size(), out.data());
+  }
+  return out;
+}
+
+struct BulkSearchOptions {
+  // 0 means one worker per hardware thread
+  size_t threads = 0;
+  // bind worker i to the i-th cpu the process may run on, linux only; off
+  // by default so concurrent callers do not all pile onto the same cpus
+  bool pin = false;
+  // give every worker one slice of the array and only the keys that fall in
+  // it, so its share of the array can stay in that core's cache
+  bool partition = false;
+};
+
+// pins t to the index-th cpu of the process affinity mask, wrapping around,
+// so a restricted cpuset is respected
+void pin_thread(thread &t, const size_t &index) {
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+  size_t count = size_t(CPU_COUNT(&allowed));
+  if (count == 0) return;
+  size_t skip = index % count;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &allowed) && skip-- == 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+      return;
+    }
+  }
+#else
+  (void)t;
+  (void)index;
+#endif
+}
+
+// Bulk lookups over a pool of worker threads, out[i] is binary_search2(a, keys[i]).
+template<typename T>
+void parallel_binary_search(const vector<T> &a, const T *keys, const size_t &count, int *out,
+                            const BulkSearchOptions &options = BulkSearchOptions()) {
+  size_t workers = options.threads ? options.threads : max(1u, thread::hardware_concurrency());
+  workers = max(size_t(1), min(workers, count));
+  if (count == 0) return;
+
+  vector<thread> pool;
+  auto run = [&](function<void(size_t)> job) {
+    for (size_t w = 0; w < workers; ++w) {
+      pool.emplace_back(job, w);
+      if (options.pin) pin_thread(pool.back(), w);
+    }
+    for (auto &t : pool) t.join();
+    pool.clear();
+  };
+
+  if (!options.partition || a.empty()) {
+    run([&](size_t w) {
+      size_t first = count * w / workers, last = count * (w + 1) / workers;
+      for (size_t i = first; i < last; ++i) {
+        size_t j = branchless_lower_bound(a, keys[i]);
+        out[i] = (j < a.size() && a[j] == keys[i]) ? int(j) : -1;
+      }
+    });
+    return;
+  }
+
+  // slice w is a[bounds[w], bounds[w + 1]), a key goes to the last slice whose
+  // first element is not greater than it
+  vector<size_t> bounds(workers + 1);
+  vector<T> fences(workers - 1);
+  for (size_t w = 0; w <= workers; ++w) {
+    bounds[w] = a.size() * w / workers;
+  }
+  for (size_t w = 1; w < workers; ++w) {
+    // slices start at the first copy of their key so no run is split
+    bounds[w] = branchless_lower_bound(a, a[bounds[w]]);
+    fences[w - 1] = a[bounds[w]];
+  }
+  vector<size_t> slice(count), offsets(workers + 1), order(count);
+  for (size_t i = 0; i < count; ++i) {
+    slice[i] = branchless_upper_bound(fences, keys[i]);
+    ++offsets[slice[i] + 1];
+  }
+  partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  vector<size_t> fill = offsets;
+  for (size_t i = 0; i < count; ++i) {
+    order[fill[slice[i]]++] = i;
+  }
+  run([&](size_t w) {
+    const T *first = a.data() + bounds[w];
+    size_t n = bounds[w + 1] - bounds[w];
+    for (size_t k = offsets[w]; k < offsets[w + 1]; ++k) {
+      size_t i = order[k];
+      size_t j = branchless_lower_bound(first, n, keys[i]);
+      out[i] = (j < n && first[j] == keys[i]) ? int(bounds[w] + j) : -1;
+    }
+  });
+}
+
+// to - from for from <= to, as a double. Integer keys subtract exactly in
+// the unsigned type first: that cannot overflow, and keys past 2^53, where
+// neighbouring keys round to the same double, keep their difference.
+template<typename T>
+double key_distance(const T &from, const T &to, true_type) {
+  typedef typename make_unsigned<T>::type Bits;
+  return double(Bits(Bits(to) - Bits(from)));
+}
+
+template<typename T>
+double key_distance(const T &from, const T &to, false_type) {
+  return double(to) - double(from);
+}
+
+template<typename T>
+double key_distance(const T &from, const T &to) {
+  return key_distance(from, to, integral_constant<bool, is_integral<T>::value>());
+}
+
+// Probe for x in a[lo, hi] where a[lo] <= x <= a[hi] and a[lo] < a[hi].
+// Rounding can push the fraction past 1, and floating keys far apart can
+// make it inf / inf, those probes fall back to the middle.
+template<typename T>
+size_t interpolate(const vector<T> &a, const size_t &lo, const size_t &hi, const T &x) {
+  double fraction = key_distance(a[lo], x) / key_distance(a[lo], a[hi]);
+  if (!(fraction >= 0.0 && fraction <= 1.0)) {
+    return lo + (hi - lo) / 2;
+  }
+  return min(hi, lo + size_t(fraction * double(hi - lo)));
+}
+
+// Interpolation search: probe where x would sit if the keys between a[lo]
+// and a[hi] were evenly spread. O(log log n) probes on uniform keys, but
+// O(n) on skewed ones. -1 on miss, same contract as binary_search2.
+template<typename T>
+int interpolation_search(const vector<T> &a, const T &x) {
+  static_assert(is_arithmetic<T>::value, "interpolation needs arithmetic keys");
+  if (a.empty()) return -1;
+  size_t lo = 0, hi = a.size() - 1;
+  while (lo <= hi && a[lo] <= x && x <= a[hi]) {
+    if (a[lo] == a[hi]) {
+      return a[lo] == x ? int(lo) : -1;
+    }
+    size_t pos = interpolate(a, lo, hi, x);
+    if (a[pos] == x) {
+      return int(pos);
+    } else if (a[pos] < x) {
+      lo = pos + 1;
+    } else {
+      hi = pos - 1;
+    }
+  }
+  return -1;
+}
+
+// Interpolation guarded by bisection: whenever an interpolation probe fails
+// to at least halve the window, the next probe is a plain binary step, so
+// skewed keys still finish in O(log n) probes.
+template<typename T>
+int hybrid_search(const vector<T> &a, const T &x) {
+  static_assert(is_arithmetic<T>::value, "interpolation needs arithmetic keys");
+  if (a.empty()) return -1;
+  size_t lo = 0, hi = a.size() - 1;
+  bool bisect = false;
+  while (lo <= hi && a[lo] <= x && x <= a[hi]) {
+    if (a[lo] == a[hi]) {
+      return a[lo] == x ? int(lo) : -1;
+    }
+    size_t width = hi - lo;
+    size_t pos = bisect ? lo + width / 2 : interpolate(a, lo, hi, x);
+    if (a[pos] == x) {
+      return int(pos);
+    } else if (a[pos] < x) {
+      lo = pos + 1;
+    } else {
+      hi = pos - 1;
+    }
+    bisect = !bisect && hi - lo > width / 2;
+  }
+  return -1;
+}
+
+// Piecewise-linear learned index (PGM style). The sorted keys are cut into
+// segments whose line predicts every key's position within `epsilon`, so a
+// lookup is a search over the few segment keys plus a bisection over at most
+// 2 * epsilon + 3 elements. Model size and error bound trade off directly.
+// The index refers to the sorted vector rather than copying it, which has to
+// outlive the index.
+template<typename T>
+class LearnedIndex {
+
+public:
+  static_assert(is_arithmetic<T>::value, "LearnedIndex needs arithmetic keys");
+
+  struct Segment {
+    T key;
+    double slope;
+    size_t start;
+  };
+
+  LearnedIndex(const vector<T> &sorted, const size_t &epsilon = 64)
+  : data_(sorted),
+    epsilon_(epsilon) {
+    Build();
+  }
+
+  LearnedIndex(vector<T> &&, const size_t & = 64) = delete;
+
+  // position of the first element not less than x in the sorted input
+  size_t LowerBound(const T &x) const {
+    if (segments_.empty() || x <= keys_[0]) return 0;
+    size_t s = branchless_upper_bound(keys_, x) - 1;
+    size_t first = segments_[s].start;
+    size_t last = s + 1 < segments_.size() ? segments_[s + 1].start : data_.size();
+    // the answer is always inside [first, last], the error bound narrows it
+    double guess = double(first) + segments_[s].slope * key_distance(segments_[s].key, x);
+    size_t pos = size_t(min(max(guess, double(first)), double(last)));
+    size_t lo = max(first, pos > epsilon_ + 1 ? pos - epsilon_ - 1 : 0);
+    size_t hi = min(last, pos + epsilon_ + 2);
+    auto begin = data_.begin();
+    size_t i = lower_bound(begin + lo, begin + hi, x) - begin;
+    if ((i == lo && lo > first && !(data_[lo - 1] < x)) || (i == hi && hi < last)) {
+      // long runs of duplicates can sit outside the window
+      i = lower_bound(begin + first, begin + last, x) - begin;
+    }
+    return i;
+  }
+
+  // -1 on miss, same contract as binary_search2
+  int Find(const T &x) const {
+    size_t i = LowerBound(x);
+    return (i < data_.size() && data_[i] == x) ? int(i) : -1;
+  }
+
+  size_t epsilon() const {
+    return epsilon_;
+  }
+
+  const vector<Segment> &segments() const {
+    return segments_;
+  }
+
+  // bytes held by the model, not counting the keys it indexes
+  size_t model_bytes() const {
+    return segments_.size() * sizeof(Segment) + keys_.size() * sizeof(T);
+  }
+
+private:
+  const vector<T> &data_;
+  size_t epsilon_;
+  vector<Segment> segments_;
+  vector<T> keys_;
+
+  // Shrinking cone: keep the range of slopes that still predicts every point
+  // of the current segment within epsilon, start a new one when it empties.
+  // Only the first position of each distinct key is a point.
+  void Build() {
+    const double eps = double(epsilon_);
+    size_t i = 0, n = data_.size();
+    while (i < n) {
+      Segment segment { data_[i], 0.0, i };
+      double lo = 0.0, hi = numeric_limits<double>::infinity();
+      size_t j = i + 1;
+      for (; j < n; ++j) {
+        if (data_[j] == data_[j - 1]) continue;
+        double dx = key_distance(segment.key, data_[j]);
+        double dy = double(j - i);
+        double l = max(lo, (dy - eps) / dx), h = min(hi, (dy + eps) / dx);
+        if (l > h) break;
+        lo = l;
+        hi = h;
+      }
+      segment.slope = hi == numeric_limits<double>::infinity() ? lo : (lo + hi) / 2;
+      segments_.push_back(segment);
+      keys_.push_back(segment.key);
+      i = j;
+    }
+  }
+
+};
+
+// Eytzinger (BFS-order) layout: node k has children 2k and 2k + 1, so the
+// first levels of every search share a handful of cache lines and the next
+// levels can be prefetched as one contiguous block. Built once from a sorted
+// vector, positions are mapped back to the original sorted index.
+template<typename T, typename Compare = less<T>>
+class EytzingerIndex {
+
+public:
+  typedef T ValueType;
+
+  explicit EytzingerIndex(const vector<T> &sorted, Compare comp = Compare())
+  : comp_(comp),
+    keys_(sorted.size() + 1),
+    order_(sorted.size() + 1) {
+    Build(sorted, 0, 1);
+    order_[0] = sorted.size();
+  }
+
+  // position of the first element not less than x in the sorted input
+  size_t LowerBound(const T &x) const {
+    return order_[Search(x)];
+  }
+
+  // -1 on miss, same contract as binary_search2
+  int Find(const T &x) const {
+    size_t k = Search(x);
+    return (k != 0 && !comp_(x, keys_[k])) ? int(order_[k]) : -1;
+  }
+
+  size_t size() const {
+    return keys_.size() - 1;
+  }
+
+private:
+  // elements of T per cache line, the node 4 levels down for ints
+  static const size_t kBlock = 64 / sizeof(T) > 0 ? 64 / sizeof(T) : 1;
+
+  Compare comp_;
+  vector<T> keys_;
+  vector<size_t> order_;
+
+  size_t Build(const vector<T> &sorted, size_t i, const size_t &k) {
+    if (k <= size()) {
+      i = Build(sorted, i, 2 * k);
+      keys_[k] = sorted[i];
+      order_[k] = i++;
+      i = Build(sorted, i, 2 * k + 1);
+    }
+    return i;
+  }
+
+  // eytzinger position of the lower bound, 0 when every key is less than x
+  size_t Search(const T &x) const {
+    size_t k = 1, n = size();
+    while (k <= n) {
+      PrefetchBlock(k * kBlock);
+      k = 2 * k + comp_(keys_[k], x);
+    }
+    // undo the right turns taken after the last left turn
+    return k >> (TrailingOnes(k) + 1);
+  }
+
+  void PrefetchBlock(const size_t &k) const {
+    // integer arithmetic, the block may lie past the end of keys_
+    prefetch(reinterpret_cast<const void *>(reinterpret_cast<uintptr_t>(keys_.data()) + k * sizeof(T)));
+  }
+
+  static size_t TrailingOnes(const size_t &k) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(~k);
+#else
+    size_t count = 0;
+    for (size_t v = k; v & 1; v >>= 1) ++count;
+    return count;
+#endif
+  }
+
+};
+
+template<typename T, typename Compare>
+const size_t EytzingerIndex<T, Compare>::kBlock;
+
+enum class SimdLevel {
+  scalar,
+  sse42,
+  avx2
+};
+
+SimdLevel detect_simd() {
+#ifdef SEARCH_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::avx2;
+  } else if (__builtin_cpu_supports("sse4.2")) {
+    return SimdLevel::sse42;
+  }
+#endif
+  return SimdLevel::scalar;
+}
+
+// Node rank kernels: the number of keys in a 64 byte node that are less
+// than x. Keys inside a node are sorted, so this is also the child to follow.
+
+template<typename T>
+size_t node_rank_scalar(const T *node, const T &x) {
+  size_t count = 0;
+  for (size_t i = 0; i < 64 / sizeof(T); ++i) {
+    count += node[i] < x;
+  }
+  return count;
+}
+
+#ifdef SEARCH_X86_SIMD
+
+__attribute__((target("sse4.2,popcnt")))
+size_t node_rank_sse42(const int32_t *node, const int32_t &x) {
+  __m128i v = _mm_set1_epi32(x);
+  unsigned mask = 0;
+  for (int j = 0; j < 4; ++j) {
+    __m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i *>(node + 4 * j));
+    mask |= unsigned(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, keys)))) << (4 * j);
+  }
+  return __builtin_popcount(mask);
+}
+
+__attribute__((target("sse4.2,popcnt")))
+size_t node_rank_sse42(const int64_t *node, const int64_t &x) {
+  __m128i v = _mm_set1_epi64x(x);
+  unsigned mask = 0;
+  for (int j = 0; j < 4; ++j) {
+    __m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i *>(node + 2 * j));
+    mask |= unsigned(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(v, keys)))) << (2 * j);
+  }
+  return __builtin_popcount(mask);
+}
+
+__attribute__((target("avx2,popcnt")))
+size_t node_rank_avx2(const int32_t *node, const int32_t &x) {
+  __m256i v = _mm256_set1_epi32(x);
+  __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(node));
+  __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(node + 8));
+  unsigned mask = unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, lo)))) |
+                  unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, hi)))) << 8;
+  return __builtin_popcount(mask);
+}
+
+__attribute__((target("avx2,popcnt")))
+size_t node_rank_avx2(const int64_t *node, const int64_t &x) {
+  __m256i v = _mm256_set1_epi64x(x);
+  __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(node));
+  __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(node + 4));
+  unsigned mask = unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, lo)))) |
+                  unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, hi)))) << 4;
+  return __builtin_popcount(mask);
+}
+
+#endif
+
+// Static B-tree (S-tree) over 32 or 64 bit integers. Every node is one
+// cache line of sorted keys and node k's children are k * (B + 1) + 1 + i, so
+// a lookup touches log_(B+1)(n) lines instead of log_2(n). The node compare
+// uses AVX2 or SSE4.2 when the running CPU has it, plain C++ otherwise. The
+// kernels compare signed, so unsigned keys are stored with the sign bit
+// flipped, which maps their order onto the signed one.
+template<typename T>
+class StaticBTree {
+
+public:
+  static_assert(is_integral<T>::value && (sizeof(T) == 4 || sizeof(T) == 8),
+                "StaticBTree needs 32 or 64 bit integer keys");
+  typedef typename conditional<sizeof(T) == 4, int32_t, int64_t>::type KeyType;
+  static const size_t B = 64 / sizeof(KeyType);
+
+  explicit StaticBTree(const vector<T> &sorted)
+  : size_(sorted.size()),
+    blocks_((sorted.size() + B - 1) / B),
+    keys_(blocks_ * B + B),
+    order_(blocks_ * B + 1),
+    simd_(detect_simd()) {
+    // line the nodes up with cache lines
+    uintptr_t address = reinterpret_cast<uintptr_t>(keys_.data());
+    offset_ = ((64 - address % 64) % 64) / sizeof(KeyType);
+    size_t t = 0;
+    Build(sorted, t, 0);
+    order_[blocks_ * B] = size_;
+  }
+
+  StaticBTree(const StaticBTree &) = delete;
+  StaticBTree &operator=(const StaticBTree &) = delete;
+  StaticBTree(StaticBTree &&) = default;
+
+  // position of the first element not less than x in the sorted input
+  size_t LowerBound(const T &x) const {
+    return order_[Search(x)];
+  }
+
+  // -1 on miss, same contract as binary_search2
+  int Find(const T &x) const {
+    size_t slot = Search(x);
+    // padding slots hold the max key too, so a hit also needs a real slot
+    return (order_[slot] < size_ && keys_[offset_ + slot] == Key(x)) ? int(order_[slot]) : -1;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  SimdLevel simd() const {
+    return simd_;
+  }
+
+  // only lowers the level, asking for more than the CPU has is ignored
+  void set_simd(const SimdLevel &level) {
+    if (level <= detect_simd()) {
+      simd_ = level;
+    }
+  }
+
+private:
+  size_t size_;
+  size_t blocks_;
+  size_t offset_;
+  vector<KeyType> keys_;
+  vector<size_t> order_;
+  SimdLevel simd_;
+
+  size_t Child(const size_t &k, const size_t &i) const {
+    return k * (B + 1) + i + 1;
+  }
+
+  // x as stored in the nodes, order preserving
+  static KeyType Key(const T &x) {
+    typedef typename make_unsigned<KeyType>::type Bits;
+    return is_signed<T>::value ? KeyType(x) : KeyType(Bits(x) ^ (Bits(1) << (8 * sizeof(T) - 1)));
+  }
+
+  void Build(const vector<T> &sorted, size_t &t, const size_t &k) {
+    if (k >= blocks_) return;
+    for (size_t i = 0; i < B; ++i) {
+      Build(sorted, t, Child(k, i));
+      bool real = t < size_;
+      keys_[offset_ + k * B + i] = real ? Key(sorted[t]) : numeric_limits<KeyType>::max();
+      order_[k * B + i] = real ? t++ : size_;
+    }
+    Build(sorted, t, Child(k, B));
+  }
+
+  // slot (node * B + index) of the lower bound, blocks_ * B when there is none
+  size_t Search(const T &x) const {
+#ifdef SEARCH_X86_SIMD
+    if (simd_ == SimdLevel::avx2) {
+      return Descend(x, [](const KeyType *node, const KeyType &v) { return node_rank_avx2(node, v); });
+    } else if (simd_ == SimdLevel::sse42) {
+      return Descend(x, [](const KeyType *node, const KeyType &v) { return node_rank_sse42(node, v); });
+    }
+#endif
+    return Descend(x, [](const KeyType *node, const KeyType &v) { return node_rank_scalar(node, v); });
+  }
+
+  template<typename Rank>
+  size_t Descend(const T &x, Rank rank) const {
+    KeyType v = Key(x);
+    size_t k = 0, slot = blocks_ * B;
+    while (k < blocks_) {
+      size_t i = rank(keys_.data() + offset_ + k * B, v);
+      slot = i < B ? k * B + i : slot;
+      k = Child(k, i);
+    }
+    return slot;
+  }
+
+};
+
+template<typename T>
+const size_t StaticBTree<T>::B;
+
+// On-disk sorted array, searched in place through mmap.
+//
+//   offset 0     SortedFileHeader, zero padded to kSortedFilePage
+//   keys_offset  count keys of key_width bytes, native byte order
+//   index_offset every index_stride-th key, the sparse top-level index
+//
+// With the default stride one index entry covers one page of keys, so once
+// the index is in memory a lookup faults in a single page of the file.
+// Version 2 adds byte_order, kSortedFileByteOrder as the writer saw it, and
+// key_signed, so a file from a host of the other endianness or written with
+// keys of the other signedness is refused instead of misread. Version 1
+// files have zeros there and are taken as native and of the reader's type.
+
+const char kSortedFileMagic[8] = { 'S', 'O', 'R', 'T', 'K', 'E', 'Y', 'S' };
+const uint32_t kSortedFileVersion = 2;
+const uint32_t kSortedFileByteOrder = 0x01020304;
+const uint64_t kSortedFilePage = 4096;
+
+struct SortedFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t key_width;
+  uint64_t count;
+  uint64_t keys_offset;
+  uint64_t index_offset;
+  uint64_t index_stride;
+  uint64_t index_count;
+  uint32_t byte_order;
+  uint32_t key_signed;
+};
+
+template<typename T>
+void write_sorted_file(const string &path, const vector<T> &sorted,
+                       const size_t &stride = kSortedFilePage / sizeof(T)) {
+  static_assert(is_integral<T>::value && (sizeof(T) == 4 || sizeof(T) == 8),
+                "sorted files hold 32 or 64 bit integer keys");
+  if (!is_sorted(sorted.begin(), sorted.end())) {
+    throw invalid_argument("write_sorted_file: keys are not sorted");
+  }
+  SortedFileHeader header;
+  memcpy(header.magic, kSortedFileMagic, sizeof(header.magic));
+  header.version = kSortedFileVersion;
+  header.key_width = sizeof(T);
+  header.count = sorted.size();
+  header.keys_offset = kSortedFilePage;
+  header.index_offset = header.keys_offset + sorted.size() * sizeof(T);
+  header.index_stride = stride;
+  header.index_count = stride ? (sorted.size() + stride - 1) / stride : 0;
+  header.byte_order = kSortedFileByteOrder;
+  header.key_signed = is_signed<T>::value;
+
+  ofstream out(path, ios::binary | ios::trunc);
+  if (!out) {
+    throw runtime_error("write_sorted_file: cannot open " + path);
+  }
+  vector<char> page(kSortedFilePage, 0);
+  memcpy(page.data(), &header, sizeof(header));
+  out.write(page.data(), page.size());
+  out.write(reinterpret_cast<const char *>(sorted.data()), sorted.size() * sizeof(T));
+  for (uint64_t i = 0; i < header.index_count; ++i) {
+    out.write(reinterpret_cast<const char *>(&sorted[i * stride]), sizeof(T));
+  }
+  if (!out.flush()) {
+    throw runtime_error("write_sorted_file: write failed for " + path);
+  }
+}
+
+// Read-only view of a file from write_sorted_file. The keys stay in the
+// page cache; only the sparse index is copied into memory. Files written
+// without an index get one built on open, which reads every page once.
+template<typename T>
+class MappedSortedArray {
+
+public:
+  explicit MappedSortedArray(const string &path)
+  : data_(nullptr),
+    length_(0),
+    keys_(nullptr),
+    count_(0),
+    stride_(0) {
+    Map(path);
+    SortedFileHeader header;
+    if (length_ < sizeof(header)) {
+      Fail(path, "too short for a header");
+    }
+    memcpy(&header, data_, sizeof(header));
+    if (memcmp(header.magic, kSortedFileMagic, sizeof(header.magic)) != 0) {
+      Fail(path, "bad magic");
+    } else if (header.byte_order != 0 && header.byte_order != kSortedFileByteOrder) {
+      // checked before the version, which would read swapped as well
+      Fail(path, "written with the other byte order");
+    } else if (header.version == 0 || header.version > kSortedFileVersion) {
+      Fail(path, "unsupported version " + to_string(header.version));
+    } else if (header.version >= 2 && header.byte_order != kSortedFileByteOrder) {
+      Fail(path, "missing byte order");
+    } else if (header.key_width != sizeof(T)) {
+      Fail(path, "key width " + to_string(header.key_width) + " does not match the reader");
+    } else if (header.version >= 2 && header.key_signed != uint32_t(is_signed<T>::value)) {
+      Fail(path, string(header.key_signed ? "signed" : "unsigned") + " keys do not match the reader");
+    } else if (header.keys_offset % sizeof(T) != 0 ||
+               !Fits(header.keys_offset, header.count) ||
+               !Fits(header.index_offset, header.index_count)) {
+      Fail(path, "truncated");
+    }
+    keys_ = reinterpret_cast<const T *>(data_ + header.keys_offset);
+    count_ = header.count;
+    stride_ = header.index_stride;
+    if (stride_ && header.index_count && header.index_count == (count_ + stride_ - 1) / stride_) {
+      index_.resize(header.index_count);
+      memcpy(index_.data(), data_ + header.index_offset, index_.size() * sizeof(T));
+    } else {
+      stride_ = kSortedFilePage / sizeof(T);
+      for (size_t i = 0; i < count_; i += stride_) {
+        index_.push_back(keys_[i]);
+      }
+    }
+  }
+
+  ~MappedSortedArray() {
+    Unmap();
+  }
+
+  MappedSortedArray(const MappedSortedArray &) = delete;
+  MappedSortedArray &operator=(const MappedSortedArray &) = delete;
+
+  // position of the first key not less than x
+  size_t LowerBound(const T &x) const {
+    // keys[(b - 1) * stride] < x <= keys[b * stride], so the answer lies in
+    // one stride of keys
+    size_t b = branchless_lower_bound(index_, x);
+    if (b == 0) return 0;
+    size_t first = (b - 1) * stride_ + 1;
+    size_t last = min(b * stride_, count_);
+    return first + branchless_lower_bound(keys_ + first, last - first, x);
+  }
+
+  // -1 on miss, like binary_search2 but wide enough for any file
+  int64_t Find(const T &x) const {
+    size_t i = LowerBound(x);
+    return (i < count_ && keys_[i] == x) ? int64_t(i) : -1;
+  }
+
+  size_t size() const {
+    return count_;
+  }
+
+  const T &operator[](const size_t &i) const {
+    return keys_[i];
+  }
+
+  size_t index_entries() const {
+    return index_.size();
+  }
+
+private:
+  const char *data_;
+  size_t length_;
+  const T *keys_;
+  size_t count_;
+  size_t stride_;
+  vector<T> index_;
+#ifndef SEARCH_MMAP
+  vector<char> buffer_;
+#endif
+
+  void Fail(const string &path, const string &reason) {
+    Unmap();
+    throw runtime_error("MappedSortedArray: " + path + ": " + reason);
+  }
+
+  // count keys starting at offset lie inside the file, checked without
+  // multiplying so a corrupt count cannot wrap around
+  bool Fits(const uint64_t &offset, const uint64_t &count) const {
+    return offset <= length_ && count <= (length_ - offset) / sizeof(T);
+  }
+
+#ifdef SEARCH_MMAP
+  void Map(const string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw runtime_error("MappedSortedArray: cannot open " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw runtime_error("MappedSortedArray: cannot stat " + path);
+    }
+    length_ = st.st_size;
+    if (length_ > 0) {
+      void *p = mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+      if (p == MAP_FAILED) {
+        close(fd);
+        throw runtime_error("MappedSortedArray: cannot map " + path);
+      }
+      // lookups jump around, read-ahead would only waste the page cache
+      madvise(p, length_, MADV_RANDOM);
+      data_ = static_cast<const char *>(p);
+    }
+    close(fd);
+  }
+
+  void Unmap() {
+    if (data_) {
+      munmap(const_cast<char *>(data_), length_);
+      data_ = nullptr;
+    }
+  }
+#else
+  // no mmap: fall back to reading the whole file
+  void Map(const string &path) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+      throw runtime_error("MappedSortedArray: cannot open " + path);
+    }
+    buffer_.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    length_ = buffer_.size();
+  }
+
+  void Unmap() {
+    data_ = nullptr;
+  }
+#endif
+
+};
+
+// Sorted integers in frame-of-reference blocks. Every block of kBlock keys
+// stores its first key in an uncompressed header array and the rest as
+// key - first packed at the narrowest bit width that fits the block. Since
+// every packed value can be pulled out on its own, a lookup searches the
+// headers and then bisects inside one block without decoding it.
+template<typename T>
+class CompressedSortedSet {
+
+public:
+  static_assert(is_integral<T>::value, "CompressedSortedSet needs integer keys");
+  typedef typename make_unsigned<T>::type UnsignedType;
+  static const size_t kBlock = 128;
+
+  explicit CompressedSortedSet(const vector<T> &sorted)
+  : size_(sorted.size()) {
+    for (size_t start = 0; start < size_; start += kBlock) {
+      size_t end = min(start + kBlock, size_);
+      UnsignedType range = UnsignedType(sorted[end - 1]) - UnsignedType(sorted[start]);
+      uint8_t bits = 0;
+      while (bits < sizeof(T) * 8 && (range >> bits) != 0) ++bits;
+      firsts_.push_back(sorted[start]);
+      bits_.push_back(bits);
+      offsets_.push_back(words_.size());
+      size_t bit = 0;
+      words_.resize(words_.size() + (bits * (end - start) + 63) / 64);
+      uint64_t *out = words_.data() + offsets_.back();
+      for (size_t i = start; i < end; ++i, bit += bits) {
+        if (bits == 0) continue;
+        uint64_t v = uint64_t(UnsignedType(sorted[i]) - UnsignedType(sorted[start]));
+        out[bit / 64] |= v << (bit % 64);
+        if (bit % 64 + bits > 64) {
+          out[bit / 64 + 1] |= v >> (64 - bit % 64);
+        }
+      }
+    }
+  }
+
+  // number of keys less than x
+  size_t Rank(const T &x) const {
+    // firsts_[b - 1] < x <= firsts_[b], the answer is inside block b - 1
+    size_t b = branchless_lower_bound(firsts_, x);
+    if (b == 0) return 0;
+    --b;
+    size_t lo = 1, hi = BlockSize(b);
+    while (lo < hi) {
+      size_t middle = (lo + hi) / 2;
+      if (Get(b, middle) < x) {
+        lo = middle + 1;
+      } else {
+        hi = middle;
+      }
+    }
+    return b * kBlock + lo;
+  }
+
+  bool Contains(const T &x) const {
+    size_t i = Rank(x);
+    return i < size_ && At(i) == x;
+  }
+
+  // -1 on miss, same contract as binary_search2
+  int Find(const T &x) const {
+    size_t i = Rank(x);
+    return (i < size_ && At(i) == x) ? int(i) : -1;
+  }
+
+  T At(const size_t &i) const {
+    return Get(i / kBlock, i % kBlock);
+  }
+
+  // decodes the whole set, mostly for tests
+  vector<T> Decode() const {
+    vector<T> out(size_);
+    for (size_t i = 0; i < size_; ++i) out[i] = At(i);
+    return out;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  size_t bytes() const {
+    return words_.size() * sizeof(uint64_t) +
+           firsts_.size() * (sizeof(T) + sizeof(uint8_t) + sizeof(size_t));
+  }
+
+private:
+  size_t size_;
+  vector<T> firsts_;
+  vector<uint8_t> bits_;
+  vector<size_t> offsets_;
+  vector<uint64_t> words_;
+
+  size_t BlockSize(const size_t &b) const {
+    return min(kBlock, size_ - b * kBlock);
+  }
+
+  T Get(const size_t &b, const size_t &j) const {
+    const size_t bits = bits_[b];
+    if (bits == 0) return firsts_[b];
+    const uint64_t *in = words_.data() + offsets_[b];
+    size_t bit = j * bits, shift = bit % 64;
+    uint64_t v = in[bit / 64] >> shift;
+    if (shift + bits > 64) {
+      v |= in[bit / 64 + 1] << (64 - shift);
+    }
+    if (bits < 64) {
+      v &= (uint64_t(1) << bits) - 1;
+    }
+    return T(UnsignedType(firsts_[b]) + UnsignedType(v));
+  }
+
+};
+
+template<typename T>
+const size_t CompressedSortedSet<T>::kBlock;
+
+// Packed-memory array: a sorted array with gaps so inserts only shift a few
+// elements. Slots are split into segments of kMin..O(log n) slots, each
+// holding its keys packed to the left. When a segment overflows (or empties)
+// the smallest enclosing power-of-two window whose density is within the
+// thresholds for its height is spread out evenly again; when the whole array
+// is out of bounds it is reallocated at half density. Inserts and removes
+// cost amortized O(log^2 n) moves, a lookup is a binary search over the
+// segment heads followed by one over a single segment.
+template<typename T>
+class PackedMemoryArray {
+
+public:
+  PackedMemoryArray() {
+    Resize({});
+  }
+
+  explicit PackedMemoryArray(const vector<T> &sorted) {
+    Resize(sorted);
+  }
+
+  void Insert(const T &x) {
+    size_t s = Segment(x);
+    if (counts_[s] < segment_) {
+      T *first = &slots_[s * segment_];
+      T *last = first + counts_[s];
+      T *at = upper_bound(first, last, x);
+      move_backward(at, last, last + 1);
+      *at = x;
+      ++counts_[s];
+      Update(s, 1);
+      heads_[s] = *first;
+      ++size_;
+      return;
+    }
+    // the segment is full, find a window with room
+    for (size_t width = 2; width <= counts_.size(); width *= 2) {
+      size_t start = s / width * width;
+      if (Count(start, width) + 1 <= Upper(width) * width * segment_) {
+        auto values = Gather(start, width);
+        values.insert(upper_bound(values.begin(), values.end(), x), x);
+        Spread(values, start, width);
+        ++size_;
+        return;
+      }
+    }
+    auto values = Values();
+    values.insert(upper_bound(values.begin(), values.end(), x), x);
+    Resize(values);
+  }
+
+  // removes one copy of x, false when there is none
+  bool Remove(const T &x) {
+    if (size_ == 0) return false;
+    size_t s = Segment(x);
+    T *first = &slots_[s * segment_];
+    T *last = first + counts_[s];
+    T *at = lower_bound(first, last, x);
+    if (at == last || *at != x) return false;
+    move(at + 1, last, at);
+    --counts_[s];
+    Update(s, -1);
+    --size_;
+    if (counts_[s] > 0) {
+      heads_[s] = *first;
+      return true;
+    }
+    if (size_ == 0) {
+      Resize({});
+      return true;
+    }
+    // the segment emptied, find a window dense enough to refill it
+    for (size_t width = 2; width <= counts_.size(); width *= 2) {
+      size_t start = s / width * width;
+      if (Count(start, width) >= Lower(width) * width * segment_) {
+        Spread(Gather(start, width), start, width);
+        return true;
+      }
+    }
+    Resize(Values());
+    return true;
+  }
+
+  bool Contains(const T &x) const {
+    if (size_ == 0) return false;
+    size_t s = Segment(x);
+    const T *first = &slots_[s * segment_];
+    const T *last = first + counts_[s];
+    const T *at = lower_bound(first, last, x);
+    return at != last && *at == x;
+  }
+
+  // number of keys less than x, the position of its first copy in Values()
+  size_t LowerBound(const T &x) const {
+    if (size_ == 0) return 0;
+    // no segment is empty, so the first key not less than x is in the
+    // segment before the first head not less than x, or starts that one
+    size_t s = branchless_lower_bound(heads_, x);
+    if (s == 0) return 0;
+    --s;
+    const T *first = &slots_[s * segment_];
+    return Prefix(s) + size_t(lower_bound(first, first + counts_[s], x) - first);
+  }
+
+  // -1 on miss, same contract as binary_search2 over Values()
+  int Find(const T &x) const {
+    return Contains(x) ? int(LowerBound(x)) : -1;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  size_t capacity() const {
+    return slots_.size();
+  }
+
+  // the keys in order, without the gaps
+  vector<T> Values() const {
+    return Gather(0, counts_.size());
+  }
+
+private:
+  static const size_t kMin = 8;
+
+  size_t size_;
+  size_t segment_;
+  vector<T> slots_;
+  vector<size_t> counts_;
+  vector<T> heads_;
+  // Fenwick tree over counts_, for ranks
+  vector<size_t> tree_;
+
+  // density bounds of a window `width` segments wide: 1 and 1/8 for one
+  // segment, moving to 3/4 and 1/4 for the whole array
+  double Height(const size_t &width) const {
+    double levels = log2(double(counts_.size()));
+    return levels == 0 ? 1.0 : log2(double(width)) / levels;
+  }
+
+  double Upper(const size_t &width) const {
+    return 1.0 - 0.25 * Height(width);
+  }
+
+  double Lower(const size_t &width) const {
+    return 0.125 + 0.125 * Height(width);
+  }
+
+  // the last segment whose head is not greater than x
+  size_t Segment(const T &x) const {
+    size_t s = branchless_upper_bound(heads_, x);
+    return s == 0 ? 0 : s - 1;
+  }
+
+  // unsigned wrap-around keeps negative deltas exact
+  void Update(size_t s, const size_t &delta) {
+    for (++s; s < tree_.size(); s += s & -s) tree_[s] += delta;
+  }
+
+  // keys in the segments before s
+  size_t Prefix(size_t s) const {
+    size_t sum = 0;
+    for (; s > 0; s -= s & -s) sum += tree_[s];
+    return sum;
+  }
+
+  size_t Count(const size_t &start, const size_t &width) const {
+    size_t count = 0;
+    for (size_t s = start; s < start + width; ++s) count += counts_[s];
+    return count;
+  }
+
+  vector<T> Gather(const size_t &start, const size_t &width) const {
+    vector<T> values;
+    values.reserve(Count(start, width));
+    for (size_t s = start; s < start + width; ++s) {
+      auto first = slots_.begin() + s * segment_;
+      values.insert(values.end(), first, first + counts_[s]);
+    }
+    return values;
+  }
+
+  // every window that gets spread holds at least one key per segment, so
+  // no segment is left empty while the array has keys
+  void Spread(const vector<T> &values, const size_t &start, const size_t &width) {
+    size_t k = 0;
+    for (size_t s = start; s < start + width; ++s) {
+      size_t count = values.size() / width + (s - start < values.size() % width);
+      copy(values.begin() + k, values.begin() + k + count, slots_.begin() + s * segment_);
+      Update(s, count - counts_[s]);
+      counts_[s] = count;
+      if (count > 0) heads_[s] = values[k];
+      k += count;
+    }
+  }
+
+  void Resize(const vector<T> &values) {
+    size_t target = max(size_t(2) * values.size(), kMin);
+    segment_ = kMin;
+    while (segment_ < log2(double(target))) segment_ *= 2;
+    size_t segments = 1;
+    while (segments * segment_ < target) segments *= 2;
+    slots_.assign(segments * segment_, T());
+    counts_.assign(segments, 0);
+    tree_.assign(segments + 1, 0);
+    heads_.assign(segments, values.empty() ? T() : values.front());
+    size_ = values.size();
+    Spread(values, 0, segments);
+  }
 
-int binary_search(const vector<int> &a, const int &x) {
-  function<int(const int&, const int&)> rec = [&a, &x, &rec] (const int &start, const int &end) {
-    int middle = (start + end) / 2;
-    int val = a[middle];
-    if (val == x) {
-      return middle;
-    } else if (middle == start) {
-      return -1;
-    } else if (val > x) {
-      return rec(start, middle);
-    } else {
-      return rec(middle + 1, end);
-    }
+};
+
+template<typename T>
+const size_t PackedMemoryArray<T>::kMin;
+
+// Fractional cascading over k sorted lists. Catalogue i is list i merged
+// with every second entry of catalogue i + 1, and each entry remembers its
+// lower bound in list i and in catalogue i + 1. One binary search in the
+// first catalogue then gives every other position with at most one step back
+// per list, O(log n + k) instead of k binary searches. An entry keeps its
+// key and both 32 bit links together so each list costs one cache line.
+template<typename T>
+class FractionalCascading {
+
+public:
+  struct Entry {
+    T key;
+    // key also occurs in list i, at position own
+    bool listed;
+    uint32_t own;
+    uint32_t next;
   };
-  return rec(0, a.size());
-}
 
-int binary_search2(const vector<int> &a, const int &x) {
-  int start = 0, end = a.size();
-  while (start < end) {
-    int middle = (start + end) / 2;
-    int val = a[middle];
-    if (val == x) {
-      return middle;
-    } else if (val > x) {
-      end = middle;
-    } else {
-      start = middle + 1;
+  explicit FractionalCascading(const vector<vector<T>> &lists)
+  : catalogues_(lists.size()) {
+    for (size_t i = lists.size(); i-- > 0;) {
+      const vector<T> &list = lists[i];
+      vector<T> keys = list;
+      if (i + 1 < lists.size()) {
+        const vector<Entry> &below = catalogues_[i + 1];
+        vector<T> promoted;
+        for (size_t j = 1; j + 1 < below.size(); j += 2) promoted.push_back(below[j].key);
+        vector<T> merged(keys.size() + promoted.size());
+        merge(keys.begin(), keys.end(), promoted.begin(), promoted.end(), merged.begin());
+        keys.swap(merged);
+      }
+      if (keys.size() >= numeric_limits<uint32_t>::max()) {
+        throw length_error("FractionalCascading: catalogue too long for 32 bit links");
+      }
+      vector<Entry> &catalogue = catalogues_[i];
+      auto before = [](const Entry &e, const T &x) { return e.key < x; };
+      for (const auto &key : keys) {
+        Entry e;
+        e.key = key;
+        e.own = uint32_t(lower_bound(list.begin(), list.end(), key) - list.begin());
+        e.listed = e.own < list.size() && !(key < list[e.own]);
+        e.next = 0;
+        if (i + 1 < lists.size()) {
+          const vector<Entry> &below = catalogues_[i + 1];
+          e.next = uint32_t(lower_bound(below.begin(), below.end() - 1, key, before) - below.begin());
+        }
+        catalogue.push_back(e);
+      }
+      // sentinel past the last key
+      Entry end;
+      end.key = T();
+      end.listed = false;
+      end.own = uint32_t(list.size());
+      end.next = i + 1 < lists.size() ? uint32_t(catalogues_[i + 1].size() - 1) : 0;
+      catalogue.push_back(end);
     }
   }
-  return -1;
-}
+
+  // lower bound of x in every list
+  void LowerBounds(const T &x, size_t *out) const {
+    Walk(x, [out](const size_t &i, const Entry &e, const bool &) { out[i] = e.own; });
+  }
+
+  vector<size_t> LowerBounds(const T &x) const {
+    vector<size_t> out(catalogues_.size());
+    LowerBounds(x, out.data());
+    return out;
+  }
+
+  // binary_search2 on every list, -1 where x is missing
+  void Find(const T &x, int *out) const {
+    Walk(x, [out](const size_t &i, const Entry &e, const bool &equal) {
+      out[i] = equal && e.listed ? int(e.own) : -1;
+    });
+  }
+
+  vector<int> Find(const T &x) const {
+    vector<int> out(catalogues_.size());
+    Find(x, out.data());
+    return out;
+  }
+
+  size_t lists() const {
+    return catalogues_.size();
+  }
+
+  // entries over all catalogues, at most twice the total list length
+  size_t entries() const {
+    size_t total = 0;
+    for (const auto &catalogue : catalogues_) total += catalogue.size() - 1;
+    return total;
+  }
+
+private:
+  vector<vector<Entry>> catalogues_;
+
+  // calls visit(i, entry, entry.key == x) with the lower bound entry of x in
+  // every catalogue
+  template<typename Visit>
+  void Walk(const T &x, Visit visit) const {
+    if (catalogues_.empty()) return;
+    auto before = [](const Entry &e, const T &v) { return e.key < v; };
+    const vector<Entry> &first = catalogues_[0];
+    size_t p = branchless_lower_bound(first.data(), first.size() - 1, x, before);
+    for (size_t i = 0; i < catalogues_.size(); ++i) {
+      const vector<Entry> &catalogue = catalogues_[i];
+      const Entry &e = catalogue[p];
+      visit(i, e, p + 1 < catalogue.size() && !(x < e.key));
+      if (i + 1 < catalogues_.size()) {
+        const vector<Entry> &below = catalogues_[i + 1];
+        p = e.next;
+        prefetch(&below[p]);
+        while (p > 0 && !(below[p - 1].key < x)) --p;
+      }
+    }
+  }
+
+};
 
 TEST_CASE( "binary search" ) {
   REQUIRE(binary_search({ 1, 2, 3, 4, 5, 6 }, 2) == 1);
@@ -47,6 +1512,7 @@ TEST_CASE( "binary search" ) {
   REQUIRE(binary_search({ 1, 2, 3, 4, 5, 6 }, 6) == 5);
   REQUIRE(binary_search({ 1, 2, 3, 4, 5, 6 }, 0) == -1);
   REQUIRE(binary_search({ 1, 2, 3, 4, 5, 6 }, 7) == -1);
+  REQUIRE(binary_search({}, 1) == -1);
 }
 
 TEST_CASE( "binary search 2" ) {
@@ -56,4 +1522,1212 @@ TEST_CASE( "binary search 2" ) {
   REQUIRE(binary_search2({ 1, 2, 3, 4, 5, 6 }, 6) == 5);
   REQUIRE(binary_search2({ 1, 2, 3, 4, 5, 6 }, 0) == -1);
   REQUIRE(binary_search2({ 1, 2, 3, 4, 5, 6 }, 7) == -1);
+  REQUIRE(binary_search2({}, 1) == -1);
+}
+
+TEST_CASE( "branchless bounds" ) {
+  vector<int> a { 1, 2, 2, 2, 5, 7, 7, 9 };
+  for (int x = 0; x <= 10; ++x) {
+    REQUIRE(branchless_lower_bound(a, x) == size_t(lower_bound(a.begin(), a.end(), x) - a.begin()));
+    REQUIRE(branchless_upper_bound(a, x) == size_t(upper_bound(a.begin(), a.end(), x) - a.begin()));
+  }
+  REQUIRE(branchless_equal_range(a, 2) == make_pair(size_t(1), size_t(4)));
+  REQUIRE(branchless_equal_range(a, 6) == make_pair(size_t(5), size_t(5)));
+
+  vector<int> desc { 9, 7, 7, 5, 2 };
+  REQUIRE(branchless_lower_bound(desc, 7, greater<int>()) == 1);
+  REQUIRE(branchless_upper_bound(desc, 7, greater<int>()) == 3);
+
+  vector<string> words { "apple", "kiwi", "pear" };
+  REQUIRE(branchless_lower_bound(words, string("banana")) == 1);
+}
+
+TEST_CASE( "generic binary search" ) {
+  vector<int> a { 1, 2, 3, 4, 5, 6 };
+  REQUIRE(binary_search2(a.begin(), a.end(), 5) == a.begin() + 4);
+  REQUIRE(binary_search2(a.begin(), a.end(), 7) == a.end());
+  REQUIRE(binary_search2(a, 3L) == 2);
+  REQUIRE(binary_search2(a, 0L) == not_found);
+  REQUIRE(binary_search(a, 6L) == 5);
+  REQUIRE(binary_search(a, 7L) == not_found);
+  REQUIRE(binary_search(vector<int>{}, 7L) == not_found);
+
+  // zero-copy over a raw buffer
+  int64_t buffer[] = { -5, int64_t(1) << 40, int64_t(1) << 41, int64_t(1) << 62 };
+  REQUIRE(binary_search2(buffer, buffer + 4, int64_t(1) << 41) == buffer + 2);
+  REQUIRE(binary_search2(buffer, int64_t(1) << 62) == 3);
+  REQUIRE(binary_search2(buffer, int64_t(3)) == not_found);
+
+  vector<string> words { "apple", "kiwi", "pear", "plum" };
+  REQUIRE(binary_search2(words, string("pear")) == 2);
+  REQUIRE(binary_search2(words, "plum") == 3);
+  REQUIRE(binary_search(words, "kiwi") == 1);
+  REQUIRE(binary_search2(words, "fig") == not_found);
+
+  deque<int> d { 9, 7, 5, 3, 1 };
+  REQUIRE(binary_search2(d.begin(), d.end(), 3, greater<int>()) == d.begin() + 3);
+  REQUIRE(binary_search2(d, 9, greater<int>()) == 0);
+  REQUIRE(binary_search(d, 1, greater<int>()) == 4);
+  REQUIRE(binary_search2(d, 4, greater<int>()) == not_found);
+
+  mt19937 gen(29);
+  for (int n = 0; n < 40; ++n) {
+    deque<int> b;
+    vector<int> c;
+    for (int i = 0; i < n; ++i) c.push_back(int(gen() % 100));
+    sort(c.begin(), c.end());
+    b.assign(c.begin(), c.end());
+    for (int x = -1; x <= 101; ++x) {
+      auto lb = size_t(lower_bound(c.begin(), c.end(), x) - c.begin());
+      REQUIRE(size_t(branchless_lower_bound(b.begin(), b.end(), x) - b.begin()) == lb);
+      REQUIRE(size_t(branchless_lower_bound(c.begin(), c.end(), x) - c.begin()) == lb);
+      size_t hit = binary_search(c, x, less<int>());
+      REQUIRE((hit == not_found) == (binary_search2(c, x) == -1));
+      if (hit != not_found) REQUIRE(c[hit] == x);
+    }
+  }
+}
+
+TEST_CASE( "branchless bounds random" ) {
+  mt19937 gen(42);
+  uniform_int_distribution<> dist(0, 1000);
+  for (int n = 0; n < 70; ++n) {
+    vector<int> a(n);
+    for (auto &v : a) v = dist(gen);
+    sort(a.begin(), a.end());
+    for (int i = 0; i < 50; ++i) {
+      int x = dist(gen);
+      REQUIRE(branchless_lower_bound(a, x) == size_t(lower_bound(a.begin(), a.end(), x) - a.begin()));
+      REQUIRE(branchless_upper_bound(a, x) == size_t(upper_bound(a.begin(), a.end(), x) - a.begin()));
+      int i2 = binary_search2(a, x);
+      REQUIRE((i2 == -1) == !std::binary_search(a.begin(), a.end(), x));
+      if (i2 != -1) REQUIRE(a[i2] == x);
+    }
+  }
+}
+
+TEST_CASE( "binary search batch" ) {
+  vector<int> a { 1, 2, 3, 4, 5, 6 };
+  vector<int> expect { 1, 0, 4, 5, -1, -1 };
+  REQUIRE(binary_search_batch(a, { 2, 1, 5, 6, 0, 7 }) == expect);
+  REQUIRE(binary_search_batch(vector<int>{}, { 1, 2 }) == vector<int>({ -1, -1 }));
+  REQUIRE(binary_search_batch(a, {}).empty());
+
+  mt19937 gen(3);
+  uniform_int_distribution<> dist(0, 5000);
+  for (size_t n : { 1, 2, 3, 100, 1000 }) {
+    vector<int> b(n);
+    for (auto &v : b) v = dist(gen);
+    sort(b.begin(), b.end());
+    b.erase(unique(b.begin(), b.end()), b.end());
+    vector<int> keys(1000);
+    for (auto &v : keys) v = dist(gen);
+    auto out = binary_search_batch(b, keys);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      REQUIRE(out[i] == binary_search2(b, keys[i]));
+    }
+  }
+}
+
+TEST_CASE( "binary search sorted keys" ) {
+  vector<int> a { 1, 2, 3, 4, 5, 6 };
+  vector<int> keys { 0, 1, 1, 3, 6, 7 };
+  vector<int> out(keys.size());
+  binary_search_sorted(a, keys.data(), keys.size(), out.data());
+  REQUIRE(out == vector<int>({ -1, 0, 0, 2, 5, -1 }));
+  REQUIRE(binary_search_batch(a, keys) == out);
+
+  mt19937 gen(5);
+  for (size_t n : { 0, 1, 7, 1000, 100000 }) {
+    uniform_int_distribution<> dist(0, int(n) * 3);
+    vector<int> b(n);
+    for (auto &v : b) v = dist(gen);
+    sort(b.begin(), b.end());
+    b.erase(unique(b.begin(), b.end()), b.end());
+    for (size_t m : { 1, 10, 5000 }) {
+      vector<int> q(m);
+      for (auto &v : q) v = dist(gen);
+      sort(q.begin(), q.end());
+      vector<int> got(m);
+      binary_search_sorted(b, q.data(), m, got.data());
+      for (size_t i = 0; i < m; ++i) {
+        REQUIRE(got[i] == binary_search2(b, q[i]));
+      }
+    }
+  }
+}
+
+TEST_CASE( "parallel binary search" ) {
+  mt19937 gen(19);
+  uniform_int_distribution<> dist(0, 30000);
+  for (size_t n : { 0, 1, 5, 1000, 20000 }) {
+    vector<int> a(n);
+    for (auto &v : a) v = dist(gen) / 3;
+    sort(a.begin(), a.end());
+    a.erase(unique(a.begin(), a.end()), a.end());
+    vector<int> keys(5000);
+    for (auto &v : keys) v = dist(gen) / 3;
+    for (size_t threads : { 1, 2, 3, 8 }) {
+      for (bool partition : { false, true }) {
+        BulkSearchOptions options;
+        options.threads = threads;
+        options.partition = partition;
+        options.pin = threads == 3;
+        vector<int> out(keys.size());
+        parallel_binary_search(a, keys.data(), keys.size(), out.data(), options);
+        for (size_t i = 0; i < keys.size(); ++i) {
+          REQUIRE(out[i] == binary_search2(a, keys[i]));
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE( "interpolation search" ) {
+  vector<int> a { 1, 2, 3, 4, 5, 6 };
+  for (int x = 0; x <= 7; ++x) {
+    REQUIRE(interpolation_search(a, x) == binary_search2(a, x));
+    REQUIRE(hybrid_search(a, x) == binary_search2(a, x));
+  }
+  REQUIRE(interpolation_search(vector<int>{}, 1) == -1);
+  REQUIRE(hybrid_search(vector<int>{ 4 }, 4) == 0);
+  REQUIRE(hybrid_search(vector<double>{ 0.5, 1.5, 1e9 }, 1.5) == 1);
+
+  vector<int> full { numeric_limits<int>::min(), -1, 0, 5, numeric_limits<int>::max() };
+  vector<int64_t> full64 { numeric_limits<int64_t>::min(), 0, 1, numeric_limits<int64_t>::max() - 1,
+                           numeric_limits<int64_t>::max() };
+  for (int x : { numeric_limits<int>::min(), -1, 0, 4, 5, numeric_limits<int>::max() }) {
+    REQUIRE(interpolation_search(full, x) == binary_search2(full, x));
+    REQUIRE(hybrid_search(full, x) == binary_search2(full, x));
+  }
+  for (auto x : full64) {
+    REQUIRE(interpolation_search(full64, x) == binary_search2(full64, x));
+    REQUIRE(hybrid_search(full64, x) == binary_search2(full64, x));
+  }
+  REQUIRE(hybrid_search(full64, int64_t(2)) == -1);
+
+  // distinct keys that round to the same double
+  vector<int64_t> close { int64_t(1) << 62, (int64_t(1) << 62) + 1, (int64_t(1) << 62) + 2,
+                          (int64_t(1) << 62) + 3 };
+  vector<int64_t> stamps;
+  for (int64_t i = 0; i < 10000; ++i) stamps.push_back(1700000000000000000LL + 3 * i);
+  for (auto *keys : { &close, &stamps }) {
+    for (size_t i = 0; i < keys->size(); i += 7) {
+      for (int64_t d : { -1, 0, 1 }) {
+        int64_t x = (*keys)[i] + d;
+        REQUIRE(interpolation_search(*keys, x) == int(binary_search2(*keys, x)));
+        REQUIRE(hybrid_search(*keys, x) == int(binary_search2(*keys, x)));
+      }
+    }
+  }
+  vector<double> far { -1e308, 0.0, 1e308 };
+  for (auto x : far) REQUIRE(hybrid_search(far, x) == int(binary_search2(far, x)));
+
+  mt19937 gen(13);
+  vector<int> skewed;
+  for (int i = 0; i < 2000; ++i) skewed.push_back(i * i * (i % 7 == 0 ? 50 : 1));
+  sort(skewed.begin(), skewed.end());
+  skewed.erase(unique(skewed.begin(), skewed.end()), skewed.end());
+  uniform_int_distribution<> dist(-10, skewed.back() + 10);
+  for (int i = 0; i < 5000; ++i) {
+    int x = i % 2 ? skewed[gen() % skewed.size()] : dist(gen);
+    REQUIRE(interpolation_search(skewed, x) == binary_search2(skewed, x));
+    REQUIRE(hybrid_search(skewed, x) == binary_search2(skewed, x));
+  }
+}
+
+TEST_CASE( "learned index" ) {
+  vector<int> a { 1, 2, 3, 4, 5, 6 };
+  LearnedIndex<int> index(a, 0);
+  for (int x = 0; x <= 7; ++x) {
+    REQUIRE(index.Find(x) == binary_search2(a, x));
+  }
+  vector<int> none;
+  REQUIRE(LearnedIndex<int>(none).Find(1) == -1);
+
+  vector<int> full { numeric_limits<int>::min(), -7, 0, 1, 2, 3, numeric_limits<int>::max() };
+  vector<int64_t> full64 { numeric_limits<int64_t>::min(), -1, 0, 1, numeric_limits<int64_t>::max() };
+  for (size_t eps : { 0, 1, 64 }) {
+    LearnedIndex<int> wide(full, eps);
+    for (auto x : full) REQUIRE(wide.Find(x) == binary_search2(full, x));
+    REQUIRE(wide.LowerBound(-8) == 1);
+    LearnedIndex<int64_t> wide64(full64, eps);
+    for (auto x : full64) REQUIRE(wide64.Find(x) == binary_search2(full64, x));
+    REQUIRE(wide64.LowerBound(2) == 4);
+  }
+
+  // nanosecond timestamps: neighbours 7 apart, one double step is 256
+  vector<int64_t> stamps(100000);
+  for (size_t i = 0; i < stamps.size(); ++i) stamps[i] = 1700000000000000000LL + 7 * int64_t(i);
+  LearnedIndex<int64_t> timeline(stamps, 4);
+  REQUIRE(timeline.segments().size() == 1);
+  for (size_t i = 0; i < stamps.size(); i += 97) {
+    for (int64_t d : { -1, 0, 1 }) {
+      REQUIRE(timeline.LowerBound(stamps[i] + d) == branchless_lower_bound(stamps, stamps[i] + d));
+    }
+  }
+
+  mt19937_64 gen(17);
+  vector<int64_t> b;
+  int64_t v = 0;
+  for (int i = 0; i < 20000; ++i) {
+    // steady ticks, bursts of duplicates and the odd big jump
+    v += i % 1000 == 0 ? int64_t(gen() % 1000000) : (i % 97 < 20 ? 0 : int64_t(gen() % 10));
+    b.push_back(v);
+  }
+  for (size_t eps : { 0, 1, 4, 64, 1024 }) {
+    LearnedIndex<int64_t> learned(b, eps);
+    REQUIRE(learned.epsilon() == eps);
+    REQUIRE(!learned.segments().empty());
+    for (int i = 0; i < 3000; ++i) {
+      int64_t x = i % 2 ? b[gen() % b.size()] : int64_t(gen() % uint64_t(v + 10)) - 5;
+      REQUIRE(learned.LowerBound(x) == branchless_lower_bound(b, x));
+    }
+  }
+  REQUIRE(LearnedIndex<int64_t>(b, 4).segments().size() > LearnedIndex<int64_t>(b, 1024).segments().size());
+}
+
+TEST_CASE( "eytzinger index" ) {
+  EytzingerIndex<int> index({ 1, 2, 3, 4, 5, 6 });
+  REQUIRE(index.Find(2) == 1);
+  REQUIRE(index.Find(1) == 0);
+  REQUIRE(index.Find(5) == 4);
+  REQUIRE(index.Find(6) == 5);
+  REQUIRE(index.Find(0) == -1);
+  REQUIRE(index.Find(7) == -1);
+  REQUIRE(index.LowerBound(7) == 6);
+  REQUIRE(EytzingerIndex<int>({}).Find(1) == -1);
+
+  mt19937 gen(7);
+  uniform_int_distribution<> dist(0, 1000);
+  for (int n = 0; n < 70; ++n) {
+    vector<int> a(n);
+    for (auto &v : a) v = dist(gen);
+    sort(a.begin(), a.end());
+    EytzingerIndex<int> e(a);
+    for (int i = 0; i < 50; ++i) {
+      int x = dist(gen);
+      REQUIRE(e.LowerBound(x) == branchless_lower_bound(a, x));
+      REQUIRE((e.Find(x) == -1) == (binary_search2(a, x) == -1));
+    }
+  }
+}
+
+TEST_CASE( "static b-tree" ) {
+  StaticBTree<int> tree({ 1, 2, 3, 4, 5, 6 });
+  REQUIRE(tree.Find(2) == 1);
+  REQUIRE(tree.Find(1) == 0);
+  REQUIRE(tree.Find(5) == 4);
+  REQUIRE(tree.Find(6) == 5);
+  REQUIRE(tree.Find(0) == -1);
+  REQUIRE(tree.Find(7) == -1);
+  REQUIRE(tree.LowerBound(7) == 6);
+  REQUIRE(StaticBTree<int>({}).Find(1) == -1);
+
+  vector<int> edge { numeric_limits<int>::min(), 0, numeric_limits<int>::max() };
+  StaticBTree<int> edges(edge);
+  REQUIRE(edges.Find(numeric_limits<int>::min()) == 0);
+  REQUIRE(edges.Find(numeric_limits<int>::max()) == 2);
+  StaticBTree<int> no_max({ 1, 2, 3 });
+  REQUIRE(no_max.Find(numeric_limits<int>::max()) == -1);
+  REQUIRE(no_max.LowerBound(numeric_limits<int>::max()) == 3);
+  REQUIRE(StaticBTree<int64_t>({ 1, 2, 3 }).Find(numeric_limits<int64_t>::max()) == -1);
+
+  // unsigned keys either side of the signed range
+  vector<uint32_t> u { 0, 1, 5, 0x7fffffffu, 0x80000000u, 0xfffffffeu };
+  vector<uint64_t> u64 { 0, 3, uint64_t(1) << 63, numeric_limits<uint64_t>::max() };
+  StaticBTree<uint32_t> unsigned_tree(u);
+  StaticBTree<uint64_t> unsigned_tree64(u64);
+  for (auto level : { SimdLevel::scalar, SimdLevel::sse42, SimdLevel::avx2 }) {
+    unsigned_tree.set_simd(level);
+    unsigned_tree64.set_simd(level);
+    for (auto x : { 0u, 1u, 2u, 0x7fffffffu, 0x80000000u, 0x80000001u, 0xfffffffeu, 0xffffffffu }) {
+      REQUIRE(unsigned_tree.LowerBound(x) == branchless_lower_bound(u, x));
+      REQUIRE(unsigned_tree.Find(x) == int(binary_search2(u, x)));
+    }
+    for (auto x : { uint64_t(0), uint64_t(2), uint64_t(1) << 63, numeric_limits<uint64_t>::max() }) {
+      REQUIRE(unsigned_tree64.LowerBound(x) == branchless_lower_bound(u64, x));
+      REQUIRE(unsigned_tree64.Find(x) == int(binary_search2(u64, x)));
+    }
+  }
+
+  mt19937_64 gen(11);
+  vector<SimdLevel> levels { SimdLevel::scalar, SimdLevel::sse42, SimdLevel::avx2 };
+  for (size_t n : { 0, 1, 15, 16, 17, 300, 4913, 5000 }) {
+    vector<int> a(n);
+    vector<int64_t> b(n);
+    for (size_t i = 0; i < n; ++i) {
+      a[i] = int(gen() % 20000) - 10000;
+      b[i] = int64_t(gen()) / 4;
+    }
+    sort(a.begin(), a.end());
+    sort(b.begin(), b.end());
+    StaticBTree<int> ta(a);
+    StaticBTree<int64_t> tb(b);
+    for (auto level : levels) {
+      ta.set_simd(level);
+      tb.set_simd(level);
+      for (int i = 0; i < 200; ++i) {
+        int x = int(gen() % 20002) - 10001;
+        REQUIRE(ta.LowerBound(x) == branchless_lower_bound(a, x));
+        REQUIRE((ta.Find(x) == -1) == (binary_search2(a, x) == -1));
+        int64_t y = n > 0 && i % 2 ? b[gen() % n] : int64_t(gen()) / 4;
+        REQUIRE(tb.LowerBound(y) == branchless_lower_bound(b, y));
+        if (tb.Find(y) != -1) REQUIRE(b[tb.Find(y)] == y);
+      }
+    }
+  }
+}
+
+TEST_CASE( "mapped sorted file" ) {
+  const string path = "binary_search_mapped_test.keys";
+  vector<int> a { 1, 2, 3, 4, 5, 6 };
+  write_sorted_file(path, a);
+  {
+    MappedSortedArray<int> file(path);
+    REQUIRE(file.size() == 6);
+    for (int x = 0; x <= 7; ++x) {
+      REQUIRE(file.Find(x) == binary_search2(a, x));
+    }
+    REQUIRE_THROWS(MappedSortedArray<int64_t>{ path });
+  }
+
+  mt19937_64 gen(23);
+  vector<int64_t> b(100000);
+  for (auto &v : b) v = int64_t(gen() % 1000000) - 500000;
+  sort(b.begin(), b.end());
+  for (size_t stride : { 0, 1, 7, 512 }) {
+    write_sorted_file(path, b, stride);
+    MappedSortedArray<int64_t> file(path);
+    REQUIRE(file.size() == b.size());
+    REQUIRE(file.index_entries() > 0);
+    for (int i = 0; i < 2000; ++i) {
+      int64_t x = i % 2 ? b[gen() % b.size()] : int64_t(gen() % 1000010) - 500005;
+      REQUIRE(file.LowerBound(x) == branchless_lower_bound(b, x));
+    }
+  }
+
+  write_sorted_file(path, vector<int>{});
+  REQUIRE(MappedSortedArray<int>(path).Find(1) == -1);
+
+  // counts whose byte size wraps around 2^64 must not pass as in bounds
+  for (int field = 0; field < 2; ++field) {
+    write_sorted_file(path, a, 2);
+    SortedFileHeader header;
+    fstream io(path, ios::in | ios::out | ios::binary);
+    io.read(reinterpret_cast<char *>(&header), sizeof(header));
+    (field ? header.index_count : header.count) += uint64_t(1) << 62;
+    io.seekp(0);
+    io.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    io.close();
+    REQUIRE_THROWS(MappedSortedArray<int>{ path });
+  }
+
+  // the other byte order, the other signedness, and a version 1 file
+  auto patch = [&](function<void(SortedFileHeader &)> edit) {
+    write_sorted_file(path, a);
+    SortedFileHeader header;
+    fstream io(path, ios::in | ios::out | ios::binary);
+    io.read(reinterpret_cast<char *>(&header), sizeof(header));
+    edit(header);
+    io.seekp(0);
+    io.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  };
+  patch([](SortedFileHeader &h) { h.byte_order = 0x04030201; h.version = 0x02000000; });
+  REQUIRE_THROWS(MappedSortedArray<int>{ path });
+  write_sorted_file(path, vector<uint32_t>{ 1, 2, 0x80000000u });
+  REQUIRE_THROWS(MappedSortedArray<int>{ path });
+  REQUIRE(MappedSortedArray<uint32_t>(path).Find(0x80000000u) == 2);
+  patch([](SortedFileHeader &h) { h.version = 1; h.byte_order = 0; h.key_signed = 0; });
+  REQUIRE(MappedSortedArray<int>(path).Find(5) == 4);
+  patch([](SortedFileHeader &h) { h.byte_order = 0; });
+  REQUIRE_THROWS(MappedSortedArray<int>{ path });
+
+  REQUIRE_THROWS(write_sorted_file(path, vector<int>{ 2, 1 }));
+  ofstream(path, ios::binary | ios::trunc) << "not a sorted file";
+  REQUIRE_THROWS(MappedSortedArray<int>{ path });
+  remove(path.c_str());
+  REQUIRE_THROWS(MappedSortedArray<int>{ path });
+}
+
+TEST_CASE( "compressed sorted set" ) {
+  vector<int> a { 1, 2, 3, 4, 5, 6 };
+  CompressedSortedSet<int> set(a);
+  REQUIRE(set.Decode() == a);
+  for (int x = 0; x <= 7; ++x) {
+    REQUIRE(set.Find(x) == binary_search2(a, x));
+  }
+  REQUIRE(set.Rank(7) == 6);
+  REQUIRE(!CompressedSortedSet<int>({}).Contains(1));
+
+  vector<int64_t> extremes { numeric_limits<int64_t>::min(), -1, 0, numeric_limits<int64_t>::max() };
+  CompressedSortedSet<int64_t> wide(extremes);
+  REQUIRE(wide.Decode() == extremes);
+  REQUIRE(wide.Contains(numeric_limits<int64_t>::max()));
+  REQUIRE(!wide.Contains(1));
+
+  mt19937 gen(31);
+  for (uint32_t gap : { 1u, 2u, 300u, 1u << 20 }) {
+    vector<uint32_t> b;
+    uint32_t v = 0;
+    for (int i = 0; i < 3000; ++i) {
+      // runs of duplicates across block boundaries too
+      v += (i / 200) % 3 == 0 ? 0 : uint32_t(gen() % gap);
+      b.push_back(v);
+    }
+    CompressedSortedSet<uint32_t> compressed(b);
+    REQUIRE(compressed.Decode() == b);
+    for (int i = 0; i < 3000; ++i) {
+      uint32_t x = i % 2 ? b[gen() % b.size()] : uint32_t(gen() % (uint64_t(v) + 2));
+      REQUIRE(compressed.Rank(x) == branchless_lower_bound(b, x));
+      REQUIRE(compressed.Contains(x) == std::binary_search(b.begin(), b.end(), x));
+    }
+  }
+}
+
+TEST_CASE( "packed memory array" ) {
+  PackedMemoryArray<int> pma({ 1, 2, 3, 4, 5, 6 });
+  REQUIRE(pma.Contains(4));
+  REQUIRE(!pma.Contains(7));
+  pma.Insert(7);
+  pma.Insert(0);
+  REQUIRE(pma.Values() == vector<int>({ 0, 1, 2, 3, 4, 5, 6, 7 }));
+  REQUIRE(pma.Remove(3));
+  REQUIRE(!pma.Remove(3));
+  REQUIRE(!pma.Contains(3));
+  REQUIRE(pma.size() == 7);
+  REQUIRE(pma.LowerBound(3) == 3);
+  REQUIRE(pma.LowerBound(8) == 7);
+  REQUIRE(pma.Find(4) == 3);
+  REQUIRE(pma.Find(3) == -1);
+
+  PackedMemoryArray<int> empty;
+  REQUIRE(!empty.Contains(1));
+  REQUIRE(!empty.Remove(1));
+  REQUIRE(empty.LowerBound(1) == 0);
+  REQUIRE(empty.Find(1) == -1);
+
+  mt19937 gen(37);
+  PackedMemoryArray<int> dynamic;
+  multiset<int> reference;
+  for (int round = 0; round < 3; ++round) {
+    // grow, then shrink back to nothing
+    for (int i = 0; i < 20000; ++i) {
+      int x = int(gen() % 5000);
+      if (gen() % 4 == 0) {
+        REQUIRE(dynamic.Remove(x) == (reference.count(x) > 0));
+        if (reference.count(x)) reference.erase(reference.find(x));
+      } else {
+        dynamic.Insert(x);
+        reference.insert(x);
+      }
+      REQUIRE(dynamic.Contains(x) == (reference.count(x) > 0));
+    }
+    vector<int> values(reference.begin(), reference.end());
+    REQUIRE(dynamic.Values() == values);
+    for (int x = -1; x <= 5001; ++x) {
+      REQUIRE(dynamic.LowerBound(x) == branchless_lower_bound(values, x));
+      REQUIRE(dynamic.Find(x) == binary_search2(values, x));
+    }
+    while (!reference.empty()) {
+      int x = *next(reference.begin(), gen() % reference.size());
+      REQUIRE(dynamic.Remove(x));
+      reference.erase(reference.find(x));
+    }
+    REQUIRE(dynamic.size() == 0);
+    REQUIRE(dynamic.Values().empty());
+  }
+}
+
+TEST_CASE( "fractional cascading" ) {
+  vector<vector<int>> lists {
+    { 1, 2, 3, 4, 5, 6 },
+    { 2, 4, 6, 8 },
+    {},
+    { 0, 0, 5, 5, 5, 9 },
+  };
+  FractionalCascading<int> cascade(lists);
+  REQUIRE(cascade.lists() == 4);
+  for (int x = -1; x <= 10; ++x) {
+    auto found = cascade.Find(x);
+    auto bounds = cascade.LowerBounds(x);
+    for (size_t i = 0; i < lists.size(); ++i) {
+      REQUIRE(bounds[i] == branchless_lower_bound(lists[i], x));
+      REQUIRE(found[i] == binary_search2(lists[i], x));
+    }
+  }
+  REQUIRE(FractionalCascading<int>({}).Find(1).empty());
+
+  mt19937 gen(43);
+  vector<vector<int>> random(30);
+  for (auto &list : random) {
+    list.resize(gen() % 300);
+    for (auto &v : list) v = int(gen() % 2000);
+    sort(list.begin(), list.end());
+  }
+  FractionalCascading<int> big(random);
+  REQUIRE(big.entries() <= 2 * 300 * 30);
+  for (int x = -1; x <= 2001; ++x) {
+    auto bounds = big.LowerBounds(x);
+    for (size_t i = 0; i < random.size(); ++i) {
+      REQUIRE(bounds[i] == branchless_lower_bound(random[i], x));
+    }
+  }
+}
+
+//
+// ====== benchmarks ======================
+// hidden from the default run, use `binary_search [benchmark]`
+//
+
+template<typename F>
+double ns_per_op(const size_t &ops, F f) {
+  auto start = chrono::steady_clock::now();
+  f();
+  auto end = chrono::steady_clock::now();
+  return chrono::duration<double, nano>(end - start).count() / ops;
+}
+
+// keeps the optimizer from dropping a loop whose results are never read
+inline void keep(const long &v) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r"(v) : "memory");
+#else
+  (void)v;
+#endif
+}
+
+// Hardware counters for the calling thread and the threads it starts while
+// they run, through perf_event_open. Counters the kernel refuses (no PMU in
+// a VM, perf_event_paranoid) report as unavailable instead of failing.
+class PerfCounters {
+
+public:
+  static const size_t kCount = 3;
+
+  PerfCounters() {
+    const uint64_t configs[kCount] = {
+#ifdef __linux__
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_INSTRUCTIONS
+#else
+      0, 0, 0
+#endif
+    };
+    for (size_t i = 0; i < kCount; ++i) {
+      fds_[i] = Open(configs[i]);
+      values_[i] = 0;
+    }
+  }
+
+  ~PerfCounters() {
+#ifdef __linux__
+    for (auto fd : fds_) {
+      if (fd >= 0) close(fd);
+    }
+#endif
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  static const char *Name(const size_t &i) {
+    static const char *names[kCount] = { "cache_misses", "branch_misses", "instructions" };
+    return names[i];
+  }
+
+  bool available(const size_t &i) const {
+    return fds_[i] >= 0;
+  }
+
+  uint64_t value(const size_t &i) const {
+    return values_[i];
+  }
+
+  void Start() {
+#ifdef __linux__
+    for (auto fd : fds_) {
+      if (fd < 0) continue;
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  void Stop() {
+#ifdef __linux__
+    for (size_t i = 0; i < kCount; ++i) {
+      if (fds_[i] < 0) continue;
+      ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+      uint64_t v = 0;
+      values_[i] = read(fds_[i], &v, sizeof(v)) == sizeof(v) ? v : 0;
+    }
+#endif
+  }
+
+private:
+  int fds_[kCount];
+  uint64_t values_[kCount];
+
+  static int Open(const uint64_t &config) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+    (void)config;
+    return -1;
+#endif
+  }
+
+};
+
+template<typename F>
+void run_threads(const size_t &threads, const size_t &count, F f) {
+  if (threads <= 1) {
+    f(size_t(0), count);
+    return;
+  }
+  vector<thread> pool;
+  for (size_t w = 0; w < threads; ++w) {
+    pool.emplace_back(f, count * w / threads, count * (w + 1) / threads);
+  }
+  for (auto &t : pool) t.join();
+}
+
+vector<int> make_sorted(const size_t &n) {
+  vector<int> a(n);
+  for (size_t i = 0; i < n; ++i) {
+    a[i] = int(i * 2);
+  }
+  return a;
+}
+
+vector<int> make_queries(const size_t &n, const size_t &count, const int &seed = 1) {
+  mt19937 gen(seed);
+  uniform_int_distribution<int> dist(0, int(n * 2));
+  vector<int> q(count);
+  for (auto &v : q) v = dist(gen);
+  return q;
+}
+
+TEST_CASE( "benchmark branchless lower bound", "[.][benchmark]" ) {
+  const size_t queries = 1 << 20;
+  cout << "size\tbytes\tbranchy\tbranchless\tstd" << endl;
+  // 4KB (L1) up to 256MB (past the last level cache on most machines)
+  for (size_t n = 1 << 10; n <= (size_t(1) << 26); n <<= 1) {
+    auto a = make_sorted(n);
+    auto q = make_queries(n, queries);
+    long sink = 0;
+    double branchy = ns_per_op(queries, [&] {
+      for (auto x : q) sink += binary_search2_branchy(a, x);
+    });
+    double branchless = ns_per_op(queries, [&] {
+      for (auto x : q) sink += binary_search2(a, x);
+    });
+    double stl = ns_per_op(queries, [&] {
+      for (auto x : q) sink += lower_bound(a.begin(), a.end(), x) - a.begin();
+    });
+    keep(sink);
+    cout << n << "\t" << n * sizeof(int) << "\t" << branchy << "\t" << branchless << "\t" << stl << endl;
+  }
+}
+
+TEST_CASE( "benchmark eytzinger index", "[.][benchmark]" ) {
+  const size_t queries = 1 << 20;
+  cout << "size\tbuild/key\tbinary_search\tbinary_search2\teytzinger" << endl;
+  for (size_t n = 1 << 10; n <= (size_t(1) << 26); n <<= 2) {
+    auto a = make_sorted(n);
+    auto q = make_queries(n, queries);
+    long sink = 0;
+    double build = ns_per_op(n, [&] {
+      EytzingerIndex<int> tmp(a);
+      sink += tmp.size();
+    });
+    EytzingerIndex<int> index(a);
+    double recursive = ns_per_op(queries, [&] {
+      for (auto x : q) sink += binary_search(a, x);
+    });
+    double branchless = ns_per_op(queries, [&] {
+      for (auto x : q) sink += binary_search2(a, x);
+    });
+    double eytzinger = ns_per_op(queries, [&] {
+      for (auto x : q) sink += index.Find(x);
+    });
+    keep(sink);
+    cout << n << "\t" << build << "\t" << recursive << "\t" << branchless << "\t" << eytzinger << endl;
+  }
+}
+
+TEST_CASE( "benchmark static b-tree", "[.][benchmark]" ) {
+  const size_t queries = 1 << 20;
+  cout << "size\tbinary_search2\teytzinger\tstree_scalar\tstree_sse42\tstree_avx2" << endl;
+  for (size_t n = 1 << 10; n <= (size_t(1) << 26); n <<= 2) {
+    auto a = make_sorted(n);
+    auto q = make_queries(n, queries);
+    EytzingerIndex<int> eytzinger(a);
+    StaticBTree<int> tree(a);
+    long sink = 0;
+    cout << n << "\t" << ns_per_op(queries, [&] {
+      for (auto x : q) sink += binary_search2(a, x);
+    });
+    cout << "\t" << ns_per_op(queries, [&] {
+      for (auto x : q) sink += eytzinger.Find(x);
+    });
+    for (auto level : { SimdLevel::scalar, SimdLevel::sse42, SimdLevel::avx2 }) {
+      tree.set_simd(level);
+      cout << "\t";
+      if (tree.simd() != level) {
+        cout << "-";
+        continue;
+      }
+      cout << ns_per_op(queries, [&] {
+        for (auto x : q) sink += tree.Find(x);
+      });
+    }
+    keep(sink);
+    cout << endl;
+  }
+}
+
+TEST_CASE( "benchmark binary search batch", "[.][benchmark]" ) {
+  const size_t n = 1 << 24;
+  auto a = make_sorted(n);
+  cout << "keys\tloop ns/key\tbatch ns/key" << endl;
+  for (size_t count = 1 << 10; count <= (1 << 20); count <<= 2) {
+    auto q = make_queries(n, count);
+    vector<int> out(count);
+    double loop = ns_per_op(count, [&] {
+      for (size_t i = 0; i < count; ++i) out[i] = binary_search2(a, q[i]);
+    });
+    double batch = ns_per_op(count, [&] {
+      binary_search_batch(a, q.data(), count, out.data());
+    });
+    keep(out[count / 2]);
+    cout << count << "\t" << loop << "\t" << batch << endl;
+  }
+}
+
+TEST_CASE( "benchmark binary search sorted keys", "[.][benchmark]" ) {
+  const size_t n = 1 << 24;
+  auto a = make_sorted(n);
+  cout << "keys\tloop ns/key\tbatch ns/key\tsorted ns/key" << endl;
+  for (size_t count = 1 << 10; count <= (1 << 22); count <<= 2) {
+    auto q = make_queries(n, count);
+    sort(q.begin(), q.end());
+    vector<int> out(count);
+    double loop = ns_per_op(count, [&] {
+      for (size_t i = 0; i < count; ++i) out[i] = binary_search2(a, q[i]);
+    });
+    double batch = ns_per_op(count, [&] {
+      binary_search_batch(a, q.data(), count, out.data());
+    });
+    double sorted = ns_per_op(count, [&] {
+      binary_search_sorted(a, q.data(), count, out.data());
+    });
+    keep(out[count / 2]);
+    cout << count << "\t" << loop << "\t" << batch << "\t" << sorted << endl;
+  }
+}
+
+vector<int64_t> make_distribution(const string &name, const size_t &n, const int &seed = 1) {
+  mt19937_64 gen(seed);
+  vector<int64_t> a(n);
+  int64_t v = 0;
+  if (name == "uniform") {
+    uniform_int_distribution<int64_t> gap(1, 16);
+    for (auto &k : a) k = v += gap(gen);
+  } else if (name == "zipfian") {
+    // pareto gaps with alpha 1.1: mostly small steps and a long tail of jumps
+    uniform_real_distribution<double> u(0.0, 1.0);
+    for (auto &k : a) k = v += 1 + int64_t(min(pow(1.0 - u(gen), -1.0 / 1.1), 1e9));
+  } else {
+    // 64 dense runs spread far apart
+    uniform_int_distribution<int64_t> jump(1, int64_t(1) << 40);
+    for (size_t i = 0; i < n; ++i) {
+      a[i] = v += (i % (n / 64 + 1) == 0) ? jump(gen) : 1;
+    }
+  }
+  return a;
+}
+
+TEST_CASE( "benchmark interpolation search", "[.][benchmark]" ) {
+  // plain interpolation is linear on clustered keys, keep the sizes modest
+  const size_t queries = 1 << 16;
+  cout << "dataset\tsize\tbinary\tinterpolation\thybrid" << endl;
+  for (auto name : { "uniform", "zipfian", "clustered" }) {
+    for (size_t n = 1 << 10; n <= (1 << 22); n <<= 4) {
+      auto a = make_distribution(name, n);
+      mt19937_64 gen(2);
+      vector<int64_t> q(queries);
+      for (auto &x : q) x = a[gen() % n] + int64_t(gen() % 2);
+      long sink = 0;
+      double binary = ns_per_op(queries, [&] {
+        for (auto x : q) sink += branchless_lower_bound(a, x);
+      });
+      double interpolation = ns_per_op(queries, [&] {
+        for (auto x : q) sink += interpolation_search(a, x);
+      });
+      double hybrid = ns_per_op(queries, [&] {
+        for (auto x : q) sink += hybrid_search(a, x);
+      });
+      keep(sink);
+      cout << name << "\t" << n << "\t" << binary << "\t" << interpolation << "\t" << hybrid << endl;
+    }
+  }
+}
+
+TEST_CASE( "benchmark learned index", "[.][benchmark]" ) {
+  const size_t queries = 1 << 20;
+  cout << "dataset\tsize\tepsilon\tsegments\tmodel bytes\tbinary\tlearned" << endl;
+  for (auto name : { "uniform", "zipfian" }) {
+    for (size_t n = 1 << 16; n <= (1 << 24); n <<= 4) {
+      auto a = make_distribution(name, n);
+      mt19937_64 gen(3);
+      vector<int64_t> q(queries);
+      for (auto &x : q) x = a[gen() % n] + int64_t(gen() % 2);
+      long sink = 0;
+      double binary = ns_per_op(queries, [&] {
+        for (auto x : q) sink += branchless_lower_bound(a, x);
+      });
+      for (size_t eps : { 16, 64, 256, 1024 }) {
+        LearnedIndex<int64_t> index(a, eps);
+        double learned = ns_per_op(queries, [&] {
+          for (auto x : q) sink += index.LowerBound(x);
+        });
+        cout << name << "\t" << n << "\t" << eps << "\t" << index.segments().size() << "\t"
+             << index.model_bytes() << "\t" << binary << "\t" << learned << endl;
+      }
+      keep(sink);
+    }
+  }
+}
+
+TEST_CASE( "benchmark parallel binary search", "[.][benchmark]" ) {
+  const size_t n = 1 << 24, count = 1 << 22;
+  auto a = make_sorted(n);
+  auto q = make_queries(n, count);
+  vector<int> out(count);
+  double single = ns_per_op(count, [&] {
+    for (size_t i = 0; i < count; ++i) out[i] = binary_search2(a, q[i]);
+  });
+  cout << "threads\tsequential\tshared\tpartitioned\t(ns/key)" << endl;
+  for (size_t threads = 1; threads <= max(1u, thread::hardware_concurrency()); threads *= 2) {
+    BulkSearchOptions options;
+    options.threads = threads;
+    options.pin = true;
+    double shared = ns_per_op(count, [&] {
+      parallel_binary_search(a, q.data(), count, out.data(), options);
+    });
+    options.partition = true;
+    double partitioned = ns_per_op(count, [&] {
+      parallel_binary_search(a, q.data(), count, out.data(), options);
+    });
+    keep(out[count / 2]);
+    cout << threads << "\t" << single << "\t" << shared << "\t" << partitioned << endl;
+  }
+}
+
+#ifdef SEARCH_MMAP
+long major_faults() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_majflt;
+}
+
+// asks the kernel to drop the file's pages, close enough to a cold start
+void drop_page_cache(const string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+}
+
+TEST_CASE( "benchmark mapped sorted file", "[.][benchmark]" ) {
+  const string path = "binary_search_mapped_bench.keys";
+  const size_t queries = 1 << 14;
+  cout << "size\tcache\topen ms\tns/lookup\tmajor faults/lookup\tvector load ms" << endl;
+  for (size_t n = 1 << 20; n <= (size_t(1) << 26); n <<= 3) {
+    write_sorted_file(path, make_sorted(n));
+    auto q = make_queries(n, queries);
+    long sink = 0;
+    drop_page_cache(path);
+    double load = ns_per_op(1, [&] {
+      ifstream in(path, ios::binary);
+      vector<int> keys(n);
+      in.seekg(kSortedFilePage);
+      in.read(reinterpret_cast<char *>(keys.data()), n * sizeof(int));
+      sink += binary_search2(keys, q[0]);
+    }) / 1e6;
+    for (auto cache : { "cold", "warm" }) {
+      if (string(cache) == "cold") drop_page_cache(path);
+      unique_ptr<MappedSortedArray<int>> file;
+      double opened = ns_per_op(1, [&] {
+        file.reset(new MappedSortedArray<int>(path));
+      }) / 1e6;
+      long faults = major_faults();
+      double lookup = ns_per_op(queries, [&] {
+        for (auto x : q) sink += file->Find(x);
+      });
+      faults = major_faults() - faults;
+      cout << n << "\t" << cache << "\t" << opened << "\t" << lookup << "\t"
+           << double(faults) / queries << "\t" << load << endl;
+    }
+    keep(sink);
+  }
+  remove(path.c_str());
+}
+#endif
+
+TEST_CASE( "benchmark compressed sorted set", "[.][benchmark]" ) {
+  const size_t queries = 1 << 20;
+  cout << "gaps\tsize\tbytes/key raw\tbytes/key compressed\traw ns\tcompressed ns" << endl;
+  for (uint32_t gap : { 4u, 64u, 4096u }) {
+    // keep the largest key inside 32 bits
+    for (size_t n = 1 << 16; n <= (1 << 24) && uint64_t(n) * gap < (uint64_t(1) << 32); n <<= 4) {
+      mt19937 gen(7);
+      vector<uint32_t> a(n);
+      uint32_t v = 0;
+      for (auto &k : a) k = v += 1 + gen() % gap;
+      CompressedSortedSet<uint32_t> set(a);
+      vector<uint32_t> q(queries);
+      for (auto &x : q) x = uint32_t(gen() % (uint64_t(v) + 1));
+      long sink = 0;
+      double raw = ns_per_op(queries, [&] {
+        for (auto x : q) sink += binary_search2(a, x);
+      });
+      double compressed = ns_per_op(queries, [&] {
+        for (auto x : q) sink += set.Contains(x);
+      });
+      keep(sink);
+      cout << "1-" << gap << "\t" << n << "\t" << double(sizeof(uint32_t)) << "\t"
+           << double(set.bytes()) / n << "\t" << raw << "\t" << compressed << endl;
+    }
+  }
+}
+
+TEST_CASE( "benchmark packed memory array", "[.][benchmark]" ) {
+  const size_t n = 1 << 20, ops = 1 << 18;
+  cout << "reads %\tsorted vector\tstd::set\tpacked memory array\t(ns/op)" << endl;
+  for (int reads : { 99, 90 }) {
+    mt19937 gen(41);
+    vector<int> a(n);
+    for (auto &v : a) v = int(gen() % (n * 8));
+    sort(a.begin(), a.end());
+    vector<pair<bool, int>> work(ops);
+    for (auto &w : work) w = make_pair(int(gen() % 100) < reads, int(gen() % (n * 8)));
+
+    auto v = a;
+    set<int> tree(a.begin(), a.end());
+    PackedMemoryArray<int> pma(a);
+    long sink = 0;
+    double vector_ns = ns_per_op(ops, [&] {
+      for (auto &w : work) {
+        if (w.first) {
+          sink += binary_search2(v, w.second);
+        } else {
+          v.insert(upper_bound(v.begin(), v.end(), w.second), w.second);
+        }
+      }
+    });
+    double set_ns = ns_per_op(ops, [&] {
+      for (auto &w : work) {
+        if (w.first) {
+          sink += tree.count(w.second);
+        } else {
+          tree.insert(w.second);
+        }
+      }
+    });
+    double pma_ns = ns_per_op(ops, [&] {
+      for (auto &w : work) {
+        if (w.first) {
+          sink += pma.Contains(w.second);
+        } else {
+          pma.Insert(w.second);
+        }
+      }
+    });
+    keep(sink);
+    cout << reads << "\t" << vector_ns << "\t" << set_ns << "\t" << pma_ns << endl;
+  }
+}
+
+TEST_CASE( "benchmark fractional cascading", "[.][benchmark]" ) {
+  const size_t per_list = 1 << 16, queries = 1 << 14;
+  cout << "lists\tbinary_search2 ns/query\tcascading ns/query\tcatalogue entries" << endl;
+  for (size_t k = 8; k <= 256; k *= 2) {
+    mt19937 gen(47);
+    vector<vector<int>> lists(k, vector<int>(per_list));
+    for (auto &list : lists) {
+      for (auto &v : list) v = int(gen() % (per_list * 16));
+      sort(list.begin(), list.end());
+    }
+    FractionalCascading<int> cascade(lists);
+    auto q = make_queries(per_list * 8, queries);
+    long sink = 0;
+    double each = ns_per_op(queries, [&] {
+      vector<int> out(k);
+      for (auto x : q) {
+        for (size_t i = 0; i < k; ++i) out[i] = binary_search2(lists[i], x);
+        sink += out[k - 1];
+      }
+    });
+    double cascading = ns_per_op(queries, [&] {
+      vector<int> out(k);
+      for (auto x : q) {
+        cascade.Find(x, out.data());
+        sink += out[k - 1];
+      }
+    });
+    keep(sink);
+    cout << k << "\t" << each << "\t" << cascading << "\t" << cascade.entries() << endl;
+  }
+}
+
+// int keys shaped like make_distribution, squeezed into the int range when
+// they do not fit
+vector<int> make_int_distribution(const string &name, const size_t &n) {
+  auto wide = make_distribution(name, n);
+  vector<int> a(n);
+  double scale = wide.empty() || wide.back() < numeric_limits<int>::max()
+                 ? 1.0 : double(numeric_limits<int>::max() - 1) / double(wide.back());
+  for (size_t i = 0; i < n; ++i) a[i] = int(double(wide[i]) * scale);
+  return a;
+}
+
+// queries where `hits` of them are keys of a, the rest are keys it lacks
+vector<int> make_hit_queries(const vector<int> &a, const size_t &count, const double &hits) {
+  mt19937 gen(53);
+  uniform_real_distribution<double> coin(0.0, 1.0);
+  uniform_int_distribution<int> any(a.front(), a.back());
+  vector<int> q(count);
+  for (auto &x : q) {
+    if (coin(gen) < hits) {
+      x = a[gen() % a.size()];
+      continue;
+    }
+    x = -1;
+    for (int tries = 0; tries < 16; ++tries) {
+      int v = any(gen);
+      if (!std::binary_search(a.begin(), a.end(), v)) {
+        x = v;
+        break;
+      }
+    }
+  }
+  return q;
+}
+
+// Machine-readable sweep over every search variant, written as JSON to
+// $BENCHMARK_JSON (binary_search_benchmark.json by default). Counters are
+// per lookup and null when perf events are not available.
+// binary_search_sorted gets the same queries in ascending order, which is
+// the input it is for. interpolation_search only runs on uniform keys, it is
+// linear per lookup on the others. FractionalCascading is left out: it looks
+// one key up in many lists, and "benchmark fractional cascading" covers it.
+TEST_CASE( "benchmark suite", "[.][benchmark][json]" ) {
+  const size_t queries = 1 << 16;
+  const char *env = getenv("BENCHMARK_JSON");
+  const string path = env ? env : "binary_search_benchmark.json";
+  ofstream json(path);
+  REQUIRE(json);
+
+  vector<size_t> thread_counts { 1 };
+  for (size_t t = 2; t <= thread::hardware_concurrency(); t *= 2) thread_counts.push_back(t);
+
+  PerfCounters counters;
+  json << "{\n  \"suite\": \"binary_search\",\n  \"queries\": " << queries << ",\n  \"results\": [";
+  bool first = true;
+  for (auto distribution : { "uniform", "zipfian", "clustered" }) {
+    for (size_t n = 1 << 10; n <= (1 << 24); n <<= 2) {
+      auto a = make_int_distribution(distribution, n);
+      EytzingerIndex<int> eytzinger(a);
+      StaticBTree<int> stree(a);
+      LearnedIndex<int> learned(a);
+      CompressedSortedSet<int> compressed(a);
+      PackedMemoryArray<int> pma(a);
+      const string keys_path = "binary_search_benchmark.keys";
+      write_sorted_file(keys_path, a);
+      MappedSortedArray<int> mapped(keys_path);
+      typedef function<void(const int *, size_t, int *)> Variant;
+      map<string, Variant> variants {
+        { "binary_search", [&](const int *q, size_t m, int *out) {
+          for (size_t i = 0; i < m; ++i) out[i] = binary_search(a, q[i]); } },
+        { "binary_search2", [&](const int *q, size_t m, int *out) {
+          for (size_t i = 0; i < m; ++i) out[i] = binary_search2(a, q[i]); } },
+        { "binary_search2_branchy", [&](const int *q, size_t m, int *out) {
+          for (size_t i = 0; i < m; ++i) out[i] = binary_search2_branchy(a, q[i]); } },
+        { "binary_search_batch", [&](const int *q, size_t m, int *out) {
+          binary_search_batch(a, q, m, out); } },
+        { "hybrid_search", [&](const int *q, size_t m, int *out) {
+          for (size_t i = 0; i < m; ++i) out[i] = hybrid_search(a, q[i]); } },
+        { "eytzinger", [&](const int *q, size_t m, int *out) {
+          for (size_t i = 0; i < m; ++i) out[i] = eytzinger.Find(q[i]); } },
+        { "static_btree", [&](const int *q, size_t m, int *out) {
+          for (size_t i = 0; i < m; ++i) out[i] = stree.Find(q[i]); } },
+        { "learned_index", [&](const int *q, size_t m, int *out) {
+          for (size_t i = 0; i < m; ++i) out[i] = learned.Find(q[i]); } },
+        { "compressed_sorted_set", [&](const int *q, size_t m, int *out) {
+          for (size_t i = 0; i < m; ++i) out[i] = compressed.Find(q[i]); } },
+        { "packed_memory_array", [&](const int *q, size_t m, int *out) {
+          for (size_t i = 0; i < m; ++i) out[i] = pma.Find(q[i]); } },
+        { "mapped_sorted_array", [&](const int *q, size_t m, int *out) {
+          for (size_t i = 0; i < m; ++i) out[i] = mapped.Find(q[i]); } },
+        { "binary_search_sorted", [&](const int *q, size_t m, int *out) {
+          binary_search_sorted(a, q, m, out); } },
+      };
+      if (distribution == string("uniform")) {
+        variants["interpolation_search"] = [&](const int *q, size_t m, int *out) {
+          for (size_t i = 0; i < m; ++i) out[i] = interpolation_search(a, q[i]);
+        };
+      }
+      for (double hits : { 0.0, 0.5, 1.0 }) {
+        auto q = make_hit_queries(a, queries, hits);
+        auto ascending = q;
+        sort(ascending.begin(), ascending.end());
+        vector<int> out(queries);
+        for (auto &variant : variants) {
+          bool sorted = variant.first == "binary_search_sorted";
+          const int *input = sorted ? ascending.data() : q.data();
+          for (auto threads : thread_counts) {
+            counters.Start();
+            double ns = ns_per_op(queries, [&] {
+              run_threads(threads, queries, [&](size_t from, size_t to) {
+                variant.second(input + from, to - from, out.data() + from);
+              });
+            });
+            counters.Stop();
+            keep(out[queries / 2]);
+            json << (first ? "" : ",") << "\n    { \"variant\": \"" << variant.first
+                 << "\", \"distribution\": \"" << distribution << "\", \"size\": " << n
+                 << ", \"hit_ratio\": " << hits << ", \"sorted_queries\": " << (sorted ? "true" : "false")
+                 << ", \"threads\": " << threads
+                 << ", \"ns_per_lookup\": " << ns;
+            for (size_t c = 0; c < PerfCounters::kCount; ++c) {
+              json << ", \"" << PerfCounters::Name(c) << "\": ";
+              if (counters.available(c)) {
+                json << double(counters.value(c)) / queries;
+              } else {
+                json << "null";
+              }
+            }
+            json << " }";
+            first = false;
+          }
+        }
+      }
+      remove(keys_path.c_str());
+    }
+  }
+  json << "\n  ]\n}\n";
+  cout << "wrote " << path << endl;
 }
@@ -1,6 +1,19 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <iostream>
+#include <list>
 #include <stack>
+#include <thread>
 #include <tuple>
+#include <utility>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <string>
 
 #define CATCH_CONFIG_MAIN
 #include <catch.hpp>
@@ -29,6 +42,530 @@ tuple<vector<int>, int> josephus1(int M, int N) {
   return make_tuple(out, players.front());
 }
 
+// Survivor only, in O(N): with k = M + 1, J(1) = 0 and J(n) = (J(n - 1) + k) % n
+// for the 0-based survivor of n players.
+int josephus2(int M, int N) {
+  long long k = (long long)M + 1, r = 0;
+  for (long long n = 2; n <= N; ++n) {
+    r = (r + k) % n;
+  }
+  return int(r + 1);
+}
+
+// Survivor only, in O(M log N): one pass around the circle removes n / k
+// players at once, and the survivor of the n - n / k that are left maps back
+// to the full circle with a shift. Below n = k the O(n) recurrence takes over.
+// The long long overload is the 64-bit one, for M and N below 2^62.
+long long josephus3(long long M, long long N) {
+  long long k = M + 1;
+  if (k == 1) return N;
+  vector<long long> sizes;
+  long long n = N;
+  while (n >= k) {
+    sizes.push_back(n);
+    n -= n / k;
+  }
+  long long r = 0;
+  for (long long m = 2; m <= n; ++m) {
+    r = (r + k % m) % m;
+  }
+  for (auto it = sizes.rbegin(); it != sizes.rend(); ++it) {
+    n = *it;
+    r -= n % k;
+    if (r < 0) {
+      r += n;
+    } else {
+      r += r / (k - 1);
+    }
+  }
+  return r + 1;
+}
+
+int josephus3(int M, int N) {
+  return int(josephus3((long long)M, (long long)N));
+}
+
+// Survivors for a whole table of (M, N) queries, out[i] is
+// josephus2(queries[i].first, queries[i].second). Queries sharing M are served
+// by one run of the josephus2 recurrence up to their largest N, reading
+// answers off as n passes each of them. A group with few queries but a huge N
+// would waste most of that run, so it asks josephus3 per query instead.
+// Groups are independent and get handed out to a pool of `threads` workers,
+// 0 means one per hardware thread.
+vector<int> josephus_batch(const vector<pair<int, int>> &queries, size_t threads = 1) {
+  vector<int> out(queries.size());
+  vector<size_t> order(queries.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  sort(order.begin(), order.end(), [&](const size_t &a, const size_t &b) {
+    return queries[a] < queries[b];
+  });
+  vector<size_t> groups;
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (i == 0 || queries[order[i]].first != queries[order[i - 1]].first) {
+      groups.push_back(i);
+    }
+  }
+  groups.push_back(order.size());
+
+  auto solve = [&](const size_t &first, const size_t &last) {
+    int M = queries[order[first]].first;
+    long long k = (long long)M + 1;
+    long long maxN = queries[order[last - 1]].second;
+    if (double(last - first) * k * log2(double(maxN) + 1) < double(maxN)) {
+      for (size_t i = first; i < last; ++i) {
+        out[order[i]] = josephus3(M, queries[order[i]].second);
+      }
+      return;
+    }
+    size_t i = first;
+    for (; i < last && queries[order[i]].second <= 1; ++i) out[order[i]] = 1;
+    long long r = 0;
+    for (long long n = 2; n <= maxN; ++n) {
+      r = (r + k) % n;
+      for (; i < last && queries[order[i]].second == n; ++i) out[order[i]] = int(r + 1);
+    }
+  };
+
+  size_t workers = threads ? threads : max(1u, thread::hardware_concurrency());
+  workers = max(size_t(1), min(workers, groups.size() - 1));
+  atomic<size_t> next(0);
+  auto job = [&] {
+    for (size_t g = next++; g + 1 < groups.size(); g = next++) {
+      solve(groups[g], groups[g + 1]);
+    }
+  };
+  if (workers == 1) {
+    job();
+    return out;
+  }
+  vector<thread> pool;
+  for (size_t w = 0; w < workers; ++w) pool.emplace_back(job);
+  for (auto &t : pool) t.join();
+  return out;
+}
+
+// The josephus2 recurrence over n in [a, b] as one function of J(a - 1).
+// Each step turns the circle of n - 1 values into n: a new slot opens just
+// before value 0, then everything rotates by k. Keeping the a - 1 starting
+// values in place and recording before which of them each new slot opened
+// (gaps) gives J(b) = (r + #gaps at or before r - origin) mod b, so any
+// stretch of the recurrence can be summarized without knowing its input.
+// The gaps stay in a sorted vector, so keep b - a small.
+class JosephusChunk {
+
+public:
+  JosephusChunk(long long M, long long a, long long b) : size_(b), origin_(0) {
+    long long k = M + 1;
+    gaps_.reserve(size_t(max(b - a + 1, 0LL)));
+    for (long long n = a; n <= b; ++n) {
+      // gap i sits at gaps_[i] + i, count the ones ahead of the origin
+      size_t lo = 0, hi = gaps_.size();
+      while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (gaps_[mid] + (long long)mid >= origin_) {
+          hi = mid;
+        } else {
+          lo = mid + 1;
+        }
+      }
+      long long gap = origin_ - (long long)lo;
+      gaps_.insert(upper_bound(gaps_.begin(), gaps_.end(), gap), gap);
+      origin_ += 1 + n - (k < n ? k : k % n);
+      while (origin_ >= n) origin_ -= n;
+    }
+  }
+
+  // J(b) given J(a - 1) = r
+  long long operator()(const long long &r) const {
+    long long pos = r + (upper_bound(gaps_.begin(), gaps_.end(), r) - gaps_.begin());
+    return (pos - origin_ + size_) % size_;
+  }
+
+private:
+  long long size_;
+  long long origin_;
+  vector<long long> gaps_;
+
+};
+
+// Survivor of one huge (M, N) across threads: the recurrence is cut into
+// chunks of `chunk` steps, each worker summarizes a slice of them with
+// JosephusChunk, then the summaries are applied in order. Waves of
+// `threads` slices keep the memory at O(threads * slice). Summarizing is
+// about 3x the work of josephus2, so it takes four or more cores to win, and
+// it is only for large M: below N / 64 josephus3's jumps are cheaper still.
+long long josephus_parallel(long long M, long long N, size_t threads = 0,
+                            long long chunk = 32, long long slice = 1 << 18) {
+  long long k = M + 1;
+  if (k < N / 64) return josephus3(M, N);
+  size_t workers = threads ? threads : max(1u, thread::hardware_concurrency());
+  slice = max(slice, chunk);
+  long long r = 0;
+  for (long long n = 2; n <= N;) {
+    vector<long long> firsts;
+    for (size_t w = 0; w < workers && n <= N; ++w, n += slice) firsts.push_back(n);
+    vector<vector<JosephusChunk>> summaries(firsts.size());
+    auto build = [&](size_t w) {
+      long long last = min(N, firsts[w] + slice - 1);
+      for (long long a = firsts[w]; a <= last; a += chunk) {
+        summaries[w].emplace_back(M, a, min(last, a + chunk - 1));
+      }
+    };
+    vector<thread> pool;
+    for (size_t w = 1; w < firsts.size(); ++w) pool.emplace_back(build, w);
+    build(0);
+    for (auto &t : pool) t.join();
+    for (auto &slice_summaries : summaries) {
+      for (auto &c : slice_summaries) r = c(r);
+    }
+  }
+  return r + 1;
+}
+
+// Fenwick (binary indexed) tree over 0/1 "still playing" flags. Prefix
+// counts and the k-th remaining player both cost O(log N).
+template<typename Index = int>
+class FenwickTree {
+
+public:
+  // n players, all still in
+  explicit FenwickTree(const Index &n)
+  : tree_(size_t(n) + 1) {
+    for (Index i = 1; i <= n; ++i) {
+      tree_[size_t(i)] = i & -i;
+    }
+    step_ = 1;
+    while (step_ * 2 <= n) step_ *= 2;
+  }
+
+  // arbitrary starting counts, built in O(n)
+  explicit FenwickTree(const vector<Index> &counts)
+  : tree_(counts.size() + 1) {
+    for (size_t i = 1; i < tree_.size(); ++i) {
+      tree_[i] += counts[i - 1];
+      size_t parent = i + (i & (~i + 1));
+      if (parent < tree_.size()) tree_[parent] += tree_[i];
+    }
+    step_ = 1;
+    while (size_t(step_) * 2 < tree_.size()) step_ *= 2;
+  }
+
+  void Add(Index i, const Index &delta) {
+    for (; size_t(i) < tree_.size(); i += i & -i) {
+      tree_[size_t(i)] += delta;
+    }
+  }
+
+  // 1-based position of the k-th remaining player, k is 1-based too
+  Index Find(Index k) const {
+    return Find(k, k);
+  }
+
+  // same, and leaves in rest the rank of the k-th unit inside that slot
+  Index Find(Index k, Index &rest) const {
+    Index pos = 0;
+    for (Index step = step_; step > 0; step /= 2) {
+      Index next = pos + step;
+      if (size_t(next) < tree_.size() && tree_[size_t(next)] < k) {
+        pos = next;
+        k -= tree_[size_t(next)];
+      }
+    }
+    rest = k;
+    return pos + 1;
+  }
+
+private:
+  vector<Index> tree_;
+  Index step_;
+
+};
+
+// Same elimination order and survivor as josephus1, in O(N log N): the
+// player to drop is found by rank in a Fenwick tree instead of by erasing
+// from a vector.
+tuple<vector<int>, int> josephus4(int M, int N) {
+  vector<int> out;
+  out.reserve(N > 0 ? N - 1 : 0);
+  FenwickTree<int> players(N);
+  long long pos = 0;
+  for (int size = N; size > 1; --size) {
+    pos = (pos + M) % size;
+    int player = players.Find(int(pos) + 1);
+    out.push_back(player);
+    players.Add(player, -1);
+  }
+  return make_tuple(out, N > 0 ? players.Find(1) : 0);
+}
+
+int popcount64(const uint64_t &w) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(w);
+#else
+  int count = 0;
+  for (uint64_t v = w; v; v &= v - 1) ++count;
+  return count;
+#endif
+}
+
+// index of the k-th (1-based) set bit of w
+int select64(uint64_t w, int k) {
+  int base = 0;
+  for (int width = 32; width >= 8; width /= 2) {
+    uint64_t low = w & ((uint64_t(1) << width) - 1);
+    int count = popcount64(low);
+    if (count < k) {
+      k -= count;
+      w >>= width;
+      base += width;
+    } else {
+      w = low;
+    }
+  }
+  for (;; w >>= 1, ++base) {
+    if ((w & 1) && --k == 0) return base;
+  }
+}
+
+// Lazy elimination order: Next() computes one eliminated player at a time,
+// so the sequence can be piped elsewhere without materializing `out`. The
+// circle is one bit per player plus a Fenwick tree of per-64-player counts,
+// about 1.5 bits per player (2 with 64-bit Index) where josephus4 keeps an int
+// per player and josephus1 a second vector for the result. Index = long long
+// takes circles past 2^31 players.
+template<typename Index = int>
+class JosephusStream {
+
+public:
+  JosephusStream(Index M, Index N)
+  : M_(M),
+    size_(max(N, Index(0))),
+    pos_(0),
+    words_((size_t(size_) + 63) / 64, ~uint64_t(0)),
+    blocks_(Counts(words_, size_)) {
+    if (size_ % 64) {
+      words_.back() = (uint64_t(1) << (size_ % 64)) - 1;
+    }
+  }
+
+  // true once only the survivor is left
+  bool Done() const {
+    return size_ <= 1;
+  }
+
+  // the next eliminated player, only valid while !Done()
+  Index Next() {
+    return Next(M_);
+  }
+
+  // same, skipping `step` players this round instead of M
+  Index Next(const Index &step) {
+    // in long long, pos_ + step % size_ passes 2^31 once N > 2^30
+    pos_ = (pos_ + step % size_) % size_;
+    Index player = Select(Index(pos_) + 1);
+    words_[size_t(player - 1) / 64] &= ~(uint64_t(1) << ((player - 1) % 64));
+    blocks_.Add((player - 1) / 64 + 1, -1);
+    --size_;
+    return player;
+  }
+
+  // the last player standing, only valid once Done()
+  Index Survivor() const {
+    return size_ == 1 ? Select(1) : 0;
+  }
+
+  Index remaining() const {
+    return size_;
+  }
+
+private:
+  Index M_;
+  Index size_;
+  long long pos_;
+  vector<uint64_t> words_;
+  FenwickTree<Index> blocks_;
+
+  static vector<Index> Counts(const vector<uint64_t> &words, const Index &N) {
+    vector<Index> counts(words.size(), 64);
+    if (N % 64) counts.back() = N % 64;
+    return counts;
+  }
+
+  Index Select(const Index &k) const {
+    Index rest;
+    Index block = blocks_.Find(k, rest) - 1;
+    return block * 64 + select64(words_[size_t(block)], int(rest)) + 1;
+  }
+
+};
+
+// josephus1 without the `out` vector: each eliminated player goes to sink as
+// soon as it is known, the survivor is returned
+template<typename Sink>
+int josephus5(int M, int N, Sink sink) {
+  JosephusStream<> stream(M, N);
+  while (!stream.Done()) {
+    sink(stream.Next());
+  }
+  return stream.Survivor();
+}
+
+// Variable step: round r skips steps[r % steps.size()] players instead of a
+// fixed M, so steps = { M } is josephus5. Index picks int or 64-bit players.
+template<typename Index, typename Sink>
+Index josephus_steps(const vector<Index> &steps, Index N, Sink sink) {
+  JosephusStream<Index> stream(0, N);
+  for (size_t round = 0; !stream.Done(); ++round) {
+    sink(stream.Next(steps.empty() ? 0 : steps[round % steps.size()]));
+  }
+  return stream.Survivor();
+}
+
+// Backing stores for a literal walk around the circle. Each one keeps a cursor
+// on the current player; SkipAndRemove(M) moves it M players on, removes that
+// player and leaves the cursor on the one after, as josephus1 does with pos.
+
+// josephus1's own store: O(1) skip, but erase shifts the tail of the circle
+class VectorCircle {
+
+public:
+  explicit VectorCircle(vector<int> players) : players_(move(players)), pos_(0) {}
+
+  int SkipAndRemove(const int &M) {
+    pos_ = size_t((pos_ + (long long)M) % players_.size());
+    int player = players_[pos_];
+    players_.erase(players_.begin() + (long long)pos_);
+    if (pos_ == players_.size()) pos_ = 0;
+    return player;
+  }
+
+  int front() const { return players_[pos_]; }
+  size_t size() const { return players_.size(); }
+
+private:
+  vector<int> players_;
+  size_t pos_;
+
+};
+
+// O(1) erase, but every skipped player is a pointer chase
+class ListCircle {
+
+public:
+  explicit ListCircle(const vector<int> &players)
+  : players_(players.begin(), players.end()), size_(players.size()), pos_(players_.begin()) {}
+
+  int SkipAndRemove(const int &M) {
+    for (size_t step = size_t(M) % size_; step > 0; --step) {
+      if (++pos_ == players_.end()) pos_ = players_.begin();
+    }
+    int player = *pos_;
+    pos_ = players_.erase(pos_);
+    if (pos_ == players_.end()) pos_ = players_.begin();
+    --size_;
+    return player;
+  }
+
+  int front() const { return *pos_; }
+  size_t size() const { return size_; }
+
+private:
+  list<int> players_;
+  size_t size_;
+  list<int>::iterator pos_;
+
+};
+
+// Unrolled circular list: players sit in fixed blocks of B with a count each.
+// A skip hops whole blocks by their counts and only steps inside the last one,
+// a remove shifts at most B items. Once the circle drops below a quarter of
+// the block capacity the blocks are repacked, so there are never more than
+// about 4 * size / B of them to hop over.
+template<typename T, size_t B = 64>
+class UnrolledCircle {
+
+public:
+  explicit UnrolledCircle(const vector<T> &items) : size_(0), block_(0), offset_(0) {
+    Pack(items);
+  }
+
+  T SkipAndRemove(const size_t &M) {
+    Advance(M);
+    return Remove();
+  }
+
+  // move the cursor `steps` players on
+  void Advance(size_t steps) {
+    steps %= size_;
+    while (offset_ + steps >= counts_[block_]) {
+      steps -= counts_[block_] - offset_;
+      block_ = block_ + 1 == counts_.size() ? 0 : block_ + 1;
+      offset_ = 0;
+    }
+    offset_ += steps;
+  }
+
+  // remove the player under the cursor, the cursor moves to the next one
+  T Remove() {
+    T *block = &items_[block_ * B];
+    T item = block[offset_];
+    move(block + offset_ + 1, block + counts_[block_], block + offset_);
+    --counts_[block_];
+    --size_;
+    if (size_ && size_ * 4 < counts_.size() * B) {
+      Repack();
+    } else if (size_) {
+      Advance(0);
+    }
+    return item;
+  }
+
+  const T &front() const { return items_[block_ * B + offset_]; }
+  size_t size() const { return size_; }
+  size_t blocks() const { return counts_.size(); }
+
+private:
+  vector<T> items_;
+  vector<size_t> counts_;
+  size_t size_;
+  size_t block_;
+  size_t offset_;
+
+  void Pack(const vector<T> &items) {
+    size_ = items.size();
+    counts_.assign(max(size_t(1), (size_ + B - 1) / B), B);
+    counts_.back() = size_ - (counts_.size() - 1) * B;
+    items_.resize(counts_.size() * B);
+    copy(items.begin(), items.end(), items_.begin());
+  }
+
+  void Repack() {
+    size_t rank = offset_;
+    for (size_t b = 0; b < block_; ++b) rank += counts_[b];
+    vector<T> items;
+    items.reserve(size_);
+    for (size_t b = 0; b < counts_.size(); ++b) {
+      items.insert(items.end(), items_.begin() + long(b * B), items_.begin() + long(b * B + counts_[b]));
+    }
+    items_.clear();
+    Pack(items);
+    rank %= size_;
+    block_ = rank / B;
+    offset_ = rank % B;
+  }
+
+};
+
+// josephus1 over any of the circles above
+template<typename Circle>
+tuple<vector<int>, int> josephus_simulate(int M, int N) {
+  vector<int> out;
+  Circle circle(make_players(N));
+  while (circle.size() > 1) {
+    out.push_back(circle.SkipAndRemove(M));
+  }
+  return make_tuple(out, circle.front());
+}
 
 // M=0, N=5
 // 1, 2, 3, 4, 5
@@ -52,11 +589,428 @@ TEST_CASE( "josephus1 - 2" ) {
   REQUIRE(get<1>(result) == 5);
 }
 
+TEST_CASE( "josephus survivor" ) {
+  REQUIRE(josephus2(1, 5) == 3);
+  REQUIRE(josephus2(0, 5) == 5);
+  REQUIRE(josephus3(1, 5) == 3);
+  REQUIRE(josephus3(0, 5) == 5);
+  for (int M = 0; M <= 12; ++M) {
+    for (int N = 1; N <= 80; ++N) {
+      int survivor = get<1>(josephus1(M, N));
+      REQUIRE(josephus2(M, N) == survivor);
+      REQUIRE(josephus3(M, N) == survivor);
+    }
+  }
+  REQUIRE(josephus2(1000, 7) == get<1>(josephus1(1000, 7)));
+  REQUIRE(josephus3(1000, 7) == get<1>(josephus1(1000, 7)));
+  REQUIRE(josephus3(2, 1000000) == josephus2(2, 1000000));
+  REQUIRE(josephus3(99, 1000000) == josephus2(99, 1000000));
+}
+
+TEST_CASE( "josephus 64-bit and variable steps" ) {
+  // k = 2 has a closed form: 2 (N - 2^floor(log2 N)) + 1
+  long long N = 3000000000LL;
+  REQUIRE(josephus3(1LL, N) == 2 * (N - (1LL << 31)) + 1);
+  REQUIRE(josephus3(99LL, 1000000LL) == josephus3(99, 1000000));
+  long long huge = 1000000000000000000LL;
+  JosephusStream<long long> stream(huge, 50);
+  while (!stream.Done()) stream.Next();
+  REQUIRE(stream.Survivor() == josephus3(huge, 50LL));
+
+  // int players, but positions past 2^31 mid-step
+  int big = (1 << 30) + 5;
+  JosephusStream<int> circle(0, big);
+  REQUIRE(circle.Next(big - 1) == big);
+  REQUIRE(circle.Next(big - 2) == big - 1);
+  REQUIRE(circle.Next(big - 3) == big - 2);
+
+  // reference: erase from a plain vector, round r skips steps[r % size]
+  auto simulate = [](const vector<int> &steps, int n) {
+    vector<int> players = make_players(n), order;
+    long long pos = 0;
+    for (size_t round = 0; players.size() > 1; ++round) {
+      pos = (pos + steps[round % steps.size()]) % (long long)players.size();
+      order.push_back(players[size_t(pos)]);
+      players.erase(players.begin() + pos);
+    }
+    return make_tuple(order, players.empty() ? 0 : players[0]);
+  };
+  for (auto steps : vector<vector<int>> { { 1 }, { 3 }, { 1, 2, 3 }, { 0, 7, 100, 2 } }) {
+    for (int n : { 1, 2, 5, 64, 65, 200 }) {
+      vector<int> order;
+      int survivor = josephus_steps(steps, n, [&](int player) { order.push_back(player); });
+      REQUIRE(make_tuple(order, survivor) == simulate(steps, n));
+    }
+  }
+
+  vector<long long> wide;
+  long long last = josephus_steps(vector<long long> { 4 }, 1000LL,
+                                  [&](long long player) { wide.push_back(player); });
+  vector<int> narrow;
+  int last_narrow;
+  tie(narrow, last_narrow) = josephus1(4, 1000);
+  REQUIRE(vector<long long>(narrow.begin(), narrow.end()) == wide);
+  REQUIRE(last == last_narrow);
+}
+
+TEST_CASE( "josephus circles" ) {
+  UnrolledCircle<int, 4> circle(make_players(10));
+  REQUIRE(circle.blocks() == 3);
+  REQUIRE(circle.SkipAndRemove(5) == 6);
+  REQUIRE(circle.front() == 7);
+  circle.Advance(7);
+  REQUIRE(circle.front() == 4);
+  for (int i = 0; i < 7; ++i) circle.Remove();
+  REQUIRE(circle.size() == 2);
+  REQUIRE(circle.blocks() == 1);
+
+  for (int M = 0; M <= 12; ++M) {
+    for (int N = 1; N <= 80; N += 3) {
+      auto expect = josephus1(M, N);
+      REQUIRE(josephus_simulate<VectorCircle>(M, N) == expect);
+      REQUIRE(josephus_simulate<ListCircle>(M, N) == expect);
+      REQUIRE(josephus_simulate<UnrolledCircle<int>>(M, N) == expect);
+      REQUIRE((josephus_simulate<UnrolledCircle<int, 4>>(M, N) == expect));
+    }
+  }
+  REQUIRE((josephus_simulate<UnrolledCircle<int, 8>>(12345, 1000) == josephus1(12345, 1000)));
+}
+
+TEST_CASE( "josephus parallel" ) {
+  // every summary against the plain recurrence, for every input
+  for (long long M : { 0, 1, 2, 6, 40 }) {
+    for (long long a = 2; a <= 30; a += 7) {
+      for (long long b = a; b <= a + 40; b += 3) {
+        JosephusChunk chunk(M, a, b);
+        for (long long r0 = 0; r0 < a - 1; ++r0) {
+          long long r = r0;
+          for (long long n = a; n <= b; ++n) r = (r + M + 1) % n;
+          REQUIRE(chunk(r0) == r);
+        }
+      }
+    }
+  }
+  for (int M = 0; M <= 12; ++M) {
+    for (int N = 1; N <= 80; ++N) {
+      REQUIRE(josephus_parallel(M, N, 3, 7, 20) == get<1>(josephus1(M, N)));
+    }
+  }
+  REQUIRE(josephus_parallel(1000, 7) == get<1>(josephus1(1000, 7)));
+  REQUIRE(josephus_parallel(99999, 200000, 4, 300, 3000) == josephus2(99999, 200000));
+  REQUIRE(josephus_parallel(123456789, 100000, 2) == josephus2(123456789, 100000));
+}
+
+TEST_CASE( "josephus batch" ) {
+  REQUIRE(josephus_batch({}).empty());
+  vector<pair<int, int>> queries { { 1, 5 }, { 0, 5 }, { 1, 1 }, { 1, 5 }, { 1, 4 } };
+  vector<int> expect { 3, 5, 1, 3, 1 };
+  REQUIRE(josephus_batch(queries) == expect);
+
+  queries.clear();
+  for (int M = 0; M <= 12; ++M) {
+    for (int N = 80; N >= 1; N -= 3) queries.emplace_back(M, N);
+  }
+  // a sparse group, answered by josephus3
+  queries.emplace_back(3, 1000000);
+  queries.emplace_back(3, 999999);
+  for (size_t threads : { 1, 3, 0 }) {
+    auto out = josephus_batch(queries, threads);
+    for (size_t i = 0; i < queries.size(); ++i) {
+      REQUIRE(out[i] == josephus2(queries[i].first, queries[i].second));
+    }
+  }
+}
+
+TEST_CASE( "josephus elimination order" ) {
+  auto result = josephus4(1, 5);
+  vector<int> expect { 2, 4, 1, 5 };
+  REQUIRE(get<0>(result) == expect);
+  REQUIRE(get<1>(result) == 3);
+  for (int M = 0; M <= 12; ++M) {
+    for (int N = 1; N <= 80; ++N) {
+      REQUIRE(josephus4(M, N) == josephus1(M, N));
+    }
+  }
+  REQUIRE(josephus4(12345, 1000) == josephus1(12345, 1000));
+}
+
+TEST_CASE( "josephus stream" ) {
+  JosephusStream<> stream(1, 5);
+  vector<int> out;
+  while (!stream.Done()) {
+    out.push_back(stream.Next());
+  }
+  vector<int> expect { 2, 4, 1, 5 };
+  REQUIRE(out == expect);
+  REQUIRE(stream.Survivor() == 3);
+
+  REQUIRE(select64(1, 1) == 0);
+  REQUIRE(select64(~uint64_t(0), 64) == 63);
+  REQUIRE(select64(uint64_t(1) << 40 | 1, 2) == 40);
 
+  for (int M = 0; M <= 12; ++M) {
+    for (int N : { 1, 2, 5, 63, 64, 65, 130, 200 }) {
+      vector<int> seen;
+      int survivor = josephus5(M, N, [&](int player) { seen.push_back(player); });
+      vector<int> order;
+      int last;
+      tie(order, last) = josephus1(M, N);
+      REQUIRE(seen == order);
+      REQUIRE(survivor == last);
+    }
+  }
+}
 
+//
+// ====== benchmarks ======================
+// hidden from the default run, use `josephus [benchmark]`
+//
 
+template<typename F>
+double ms(F f) {
+  auto start = chrono::steady_clock::now();
+  f();
+  auto end = chrono::steady_clock::now();
+  return chrono::duration<double, milli>(end - start).count();
+}
 
+// ms per call, repeating short calls until the total is long enough to time
+double ms_per_call(const function<void()> &f, const double &min_ms = 20) {
+  double total = 0;
+  size_t calls = 0;
+  for (size_t batch = 1; total < min_ms; batch *= 2) {
+    total += ms([&] { for (size_t i = 0; i < batch; ++i) f(); });
+    calls += batch;
+  }
+  return total / double(calls);
+}
 
+// least-squares slope of log(t) against log(n): t ~ n^slope
+double fit_exponent(const vector<double> &n, const vector<double> &t) {
+  double sx = 0, sy = 0, sxx = 0, sxy = 0, m = double(n.size());
+  for (size_t i = 0; i < n.size(); ++i) {
+    double x = log(n[i]), y = log(t[i]);
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+  }
+  return (m * sxy - sx * sy) / (m * sxx - sx * sx);
+}
 
+TEST_CASE( "benchmark josephus survivor", "[.][benchmark]" ) {
+  cout << "M\tN\tjosephus1 ms\tjosephus2 ms\tjosephus3 ms" << endl;
+  for (int M : { 1, 16, 1000 }) {
+    for (int N = 1000; N <= 100000000; N *= 10) {
+      int a = 0, b = 0, c = 0;
+      cout << M << "\t" << N << "\t";
+      if (N <= 100000) {
+        cout << ms([&] { a = get<1>(josephus1(M, N)); });
+      } else {
+        cout << "-";
+      }
+      cout << "\t" << ms([&] { b = josephus2(M, N); })
+           << "\t" << ms([&] { c = josephus3(M, N); }) << endl;
+      CHECK(b == c);
+      if (a) CHECK(a == b);
+    }
+  }
+}
 
+TEST_CASE( "benchmark josephus elimination order", "[.][benchmark]" ) {
+  cout << "M\tN\tjosephus1 ms\tjosephus4 ms" << endl;
+  for (int M : { 1, 1000 }) {
+    for (int N = 1000; N <= 100000000; N *= 10) {
+      tuple<vector<int>, int> a, b;
+      cout << M << "\t" << N << "\t";
+      if (N <= 100000) {
+        cout << ms([&] { a = josephus1(M, N); });
+      } else {
+        cout << "-";
+      }
+      cout << "\t" << ms([&] { b = josephus4(M, N); }) << endl;
+      CHECK(get<1>(b) == josephus3(M, N));
+      if (N <= 100000) CHECK(a == b);
+    }
+  }
+}
+
+TEST_CASE( "benchmark josephus stream", "[.][benchmark]" ) {
+  cout << "M\tN\tjosephus4 ms\tjosephus5 ms\tstructure bytes/player" << endl;
+  for (int M : { 1, 1000 }) {
+    for (int N = 1000; N <= 100000000; N *= 10) {
+      long long sum4 = 0, sum5 = 0;
+      double t4 = ms([&] {
+        auto result = josephus4(M, N);
+        for (auto p : get<0>(result)) sum4 += p;
+      });
+      double t5 = ms([&] {
+        josephus5(M, N, [&](int p) { sum5 += p; });
+      });
+      CHECK(sum4 == sum5);
+      cout << M << "\t" << N << "\t" << t4 << "\t" << t5 << "\t"
+           << (N / 8.0 + (N / 64.0 + 1) * sizeof(int)) / N << endl;
+    }
+  }
+}
+
+TEST_CASE( "benchmark josephus batch", "[.][benchmark]" ) {
+  cout << "grid\tqueries\tjosephus2 ms\tbatch ms\tbatch x4 ms" << endl;
+  for (int maxN : { 1000, 10000, 100000 }) {
+    // every M below 64 against N on a 1% grid
+    vector<pair<int, int>> queries;
+    for (int M = 0; M < 64; ++M) {
+      for (int N = maxN / 100; N <= maxN; N += maxN / 100) queries.emplace_back(M, N);
+    }
+    long long sum2 = 0, sum_batch = 0, sum_pool = 0;
+    double t2 = ms([&] {
+      for (auto &q : queries) sum2 += josephus2(q.first, q.second);
+    });
+    double t_batch = ms([&] {
+      for (auto r : josephus_batch(queries)) sum_batch += r;
+    });
+    double t_pool = ms([&] {
+      for (auto r : josephus_batch(queries, 4)) sum_pool += r;
+    });
+    CHECK(sum2 == sum_batch);
+    CHECK(sum2 == sum_pool);
+    cout << "64x" << maxN << "\t" << queries.size() << "\t" << t2 << "\t"
+         << t_batch << "\t" << t_pool << endl;
+  }
+}
+
+TEST_CASE( "benchmark josephus 64-bit", "[.][benchmark]" ) {
+  cout << "N\tjosephus3 64-bit ms\tstream<int> ms\tstream<long long> ms\tsteps {1,2,3} ms" << endl;
+  for (long long N = 1000; N <= 10000000; N *= 10) {
+    long long sum_int = 0, sum_wide = 0, sum_steps = 0, survivor = 0;
+    double t3 = ms([&] { survivor = josephus3(1000LL, N); });
+    double t_int = ms([&] {
+      JosephusStream<> stream(1000, int(N));
+      while (!stream.Done()) sum_int += stream.Next();
+    });
+    double t_wide = ms([&] {
+      JosephusStream<long long> stream(1000, N);
+      while (!stream.Done()) sum_wide += stream.Next();
+    });
+    double t_steps = ms([&] {
+      josephus_steps(vector<long long> { 1, 2, 3 }, N, [&](long long p) { sum_steps += p; });
+    });
+    CHECK(sum_int == sum_wide);
+    cout << N << "\t" << t3 << "\t" << t_int << "\t" << t_wide << "\t" << t_steps << endl;
+  }
+  for (long long N : { 1LL << 32, 1LL << 40, 1LL << 60 }) {
+    long long survivor = 0;
+    double t3 = ms([&] { survivor = josephus3(1000LL, N); });
+    CHECK(survivor >= 1);
+    cout << N << "\t" << t3 << "\t-\t-\t-" << endl;
+  }
+}
+
+TEST_CASE( "benchmark josephus circles", "[.][benchmark]" ) {
+  cout << "M\tN\tvector ms\tlist ms\tunrolled ms\tunrolled<256> ms" << endl;
+  for (int M : { 1, 100, 10000 }) {
+    for (int N = 1000; N <= 1000000; N *= 10) {
+      int s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+      // the quadratic stores are skipped once they take minutes
+      bool quadratic = N <= 100000;
+      double t1 = quadratic ? ms([&] { s1 = get<1>(josephus_simulate<VectorCircle>(M, N)); }) : 0;
+      double t2 = quadratic ? ms([&] { s2 = get<1>(josephus_simulate<ListCircle>(M, N)); }) : 0;
+      double t3 = ms([&] { s3 = get<1>(josephus_simulate<UnrolledCircle<int>>(M, N)); });
+      double t4 = ms([&] { s4 = get<1>(josephus_simulate<UnrolledCircle<int, 256>>(M, N)); });
+      CHECK(s3 == josephus2(M, N));
+      CHECK(s4 == s3);
+      if (quadratic) {
+        CHECK(s1 == s3);
+        CHECK(s2 == s3);
+      }
+      cout << M << "\t" << N << "\t" << t1 << "\t" << t2 << "\t" << t3 << "\t" << t4 << endl;
+    }
+  }
+}
+
+TEST_CASE( "benchmark josephus parallel", "[.][benchmark]" ) {
+  // M = N keeps josephus3 from jumping, the recurrence has to run in full
+  unsigned cores = max(1u, thread::hardware_concurrency());
+  cout << "N\tjosephus2 ms\tparallel x1 ms\tparallel x" << cores << " ms" << endl;
+  for (int N = 100000; N <= 100000000; N *= 10) {
+    long long r2 = 0, r1 = 0, rn = 0;
+    double t2 = ms([&] { r2 = josephus2(N, N); });
+    double t1 = N <= 10000000 ? ms([&] { r1 = josephus_parallel(N, N, 1); }) : 0;
+    double tn = N <= 10000000 ? ms([&] { rn = josephus_parallel(N, N, cores); }) : 0;
+    if (N <= 10000000) {
+      CHECK(r1 == r2);
+      CHECK(rn == r2);
+    }
+    cout << N << "\t" << t2 << "\t" << t1 << "\t" << tn << endl;
+  }
+}
+
+// Scaling sweep: every variant over N = 2^10, 2^11, ... until a call takes
+// longer than a second (or its cap), then the slope of log(ms) over log(N)
+// from 2^12 up is checked against the expected exponent. A slope more than
+// 0.35 above it fails the run. Raw points go to $BENCHMARK_CSV
+// (josephus_benchmark.csv), points and fits to $BENCHMARK_JSON
+// (josephus_benchmark.json).
+TEST_CASE( "benchmark josephus scaling", "[.][benchmark][json]" ) {
+  const int M = 3;
+  struct Variant {
+    string name;
+    double expected;
+    long long cap;
+    function<long long(long long)> run;
+  };
+  vector<Variant> variants {
+    { "josephus1", 2, 1 << 18, [&](long long N) { return get<1>(josephus1(M, int(N))); } },
+    { "josephus2", 1, 1 << 26, [&](long long N) { return josephus2(M, int(N)); } },
+    { "josephus3", 0, 1LL << 40, [&](long long N) { return josephus3((long long)M, N); } },
+    { "josephus4", 1, 1 << 24, [&](long long N) { return get<1>(josephus4(M, int(N))); } },
+    { "josephus5", 1, 1 << 24, [&](long long N) { return josephus5(M, int(N), [](int) {}); } },
+    { "josephus_simulate<ListCircle>", 1, 1 << 22, [&](long long N) {
+      return get<1>(josephus_simulate<ListCircle>(M, int(N))); } },
+    { "josephus_simulate<UnrolledCircle>", 1, 1 << 24, [&](long long N) {
+      return get<1>(josephus_simulate<UnrolledCircle<int>>(M, int(N))); } },
+    // M = N, so josephus_parallel cannot hand off to josephus3
+    { "josephus_parallel", 1, 1 << 22, [&](long long N) { return josephus_parallel(N, N); } },
+  };
+
+  const char *json_env = getenv("BENCHMARK_JSON"), *csv_env = getenv("BENCHMARK_CSV");
+  const string json_path = json_env ? json_env : "josephus_benchmark.json";
+  const string csv_path = csv_env ? csv_env : "josephus_benchmark.csv";
+  ofstream json(json_path), csv(csv_path);
+  REQUIRE(json);
+  REQUIRE(csv);
+
+  csv << "variant,M,N,ms" << endl;
+  json << "{\n  \"suite\": \"josephus\",\n  \"M\": " << M << ",\n  \"results\": [";
+  bool first = true;
+  string fits;
+  cout << "variant\texpected\tfitted" << endl;
+  for (auto &variant : variants) {
+    vector<double> sizes, times;
+    long long sink = 0;
+    for (long long N = 1 << 10; N <= variant.cap; N *= 2) {
+      double t = ms_per_call([&] { sink += variant.run(N); });
+      csv << variant.name << "," << M << "," << N << "," << t << endl;
+      json << (first ? "" : ",") << "\n    { \"variant\": \"" << variant.name
+           << "\", \"N\": " << N << ", \"ms\": " << t << " }";
+      first = false;
+      if (N >= 1 << 12) {
+        sizes.push_back(double(N));
+        times.push_back(t);
+      }
+      if (t > 1000) break;
+    }
+    CHECK(sink != 0);
+    double fitted = sizes.size() >= 2 ? fit_exponent(sizes, times) : 0;
+    bool regressed = fitted > variant.expected + 0.35;
+    fits += string(fits.empty() ? "" : ",") + "\n    { \"variant\": \"" + variant.name +
+            "\", \"expected\": " + to_string(variant.expected) + ", \"fitted\": " +
+            to_string(fitted) + ", \"regressed\": " + (regressed ? "true" : "false") + " }";
+    cout << variant.name << "\t" << variant.expected << "\t" << fitted
+         << (regressed ? "\tREGRESSED" : "") << endl;
+    CHECK_FALSE(regressed);
+  }
+  json << "\n  ],\n  \"fits\": [" << fits << "\n  ]\n}\n";
+  cout << "wrote " << json_path << " and " << csv_path << endl;
+}
 
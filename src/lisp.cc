@@ -157,7 +157,7 @@ public:
 
   void Set(const KeyType &key, ValueType node) {
     if (Contains(key)) {
-      values_.emplace(key, node);
+      values_[key] = node;
     } else if(outer_) {
       outer_->Set(key, node);
     }
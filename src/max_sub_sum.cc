@@ -1,6 +1,33 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <cstdio>
+#include <type_traits>
+#include <thread>
+#include <string>
+#include <istream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAX_SUB_SUM_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MAX_SUB_SUM_X86_SIMD 1
+#include <immintrin.h>
+#endif
 
 #define CATCH_CONFIG_MAIN
 #include <catch.hpp>
@@ -84,6 +111,399 @@ int max_sub_sum4(const vector<int> &a) {
   return max;
 }
 
+// Summary of a stretch of the array: its total, best prefix, best suffix
+// and best subarray sums, the empty one counting as 0 like in max_sub_sum4.
+// Summaries of neighbours combine associatively, so any split of the array
+// can be summarized piece by piece and folded left to right.
+template<typename T>
+struct SubSum {
+  T total, prefix, suffix, best;
+};
+
+template<typename T>
+SubSum<T> combine(const SubSum<T> &l, const SubSum<T> &r) {
+  return SubSum<T> { l.total + r.total,
+                     max(l.prefix, l.total + r.prefix),
+                     max(r.suffix, r.total + l.suffix),
+                     max(max(l.best, r.best), l.suffix + r.prefix) };
+}
+
+// Type sums of T are kept in. The prefix sums of a long int32 array leave
+// int32 long before its best subarray does (10^6 times -1000 is enough),
+// so int32 sums go to int64, which holds any 2^32 of them exactly.
+template<typename T>
+using SumType = typename conditional<is_same<T, int32_t>::value, int64_t, T>::type;
+
+// max_sub_sum4 again as max over j of P[j] - min(P[0..j]), P the prefix sums
+// with P[0] = 0, for any element type
+template<typename T>
+SubSum<SumType<T>> sub_sum_scalar(const T *a, size_t n) {
+  SumType<T> prefix = 0, low = 0, high = 0, best = 0;
+  for (size_t i = 0; i < n; ++i) {
+    prefix += a[i];
+    low = min(low, prefix);
+    high = max(high, prefix);
+    best = max(best, prefix - low);
+  }
+  return SubSum<SumType<T>> { prefix, high, prefix - low, best };
+}
+
+template<typename T>
+T max_sub_sum_scalar(const T *a, size_t n) {
+  return T(sub_sum_scalar(a, n).best);
+}
+
+// Folds per-lane (total, lowest prefix, highest prefix, best) in lane order
+template<typename T>
+SubSum<T> fold_lanes(const T *total, const T *low, const T *high, const T *best, size_t count) {
+  SubSum<T> sum { 0, 0, 0, 0 };
+  for (size_t i = 0; i < count; ++i) {
+    sum = combine(sum, SubSum<T> { total[i], high[i], total[i] - low[i], best[i] });
+  }
+  return sum;
+}
+
+bool has_avx2() {
+#ifdef MAX_SUB_SUM_X86_SIMD
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+#ifdef MAX_SUB_SUM_X86_SIMD
+
+// AVX2 kernels: the array is cut into one segment per lane and every lane
+// runs the scalar loop over its own segment, eight (or four) Kadanes in
+// step. Loads stay contiguous: a block from each segment is read and
+// transposed in registers, so row t holds element t of every segment. The
+// lanes' summaries are folded in order at the end, and the tail that does
+// not fill a block goes through sub_sum_scalar. int32 runs in int64 lanes,
+// see SumType.
+
+__attribute__((target("avx2")))
+inline void transpose_epi32(__m256i r[8]) {
+  __m256i t[8], u[8];
+  for (int i = 0; i < 8; i += 2) {
+    t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+    t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+  }
+  for (int i = 0; i < 8; i += 4) {
+    u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+    u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+    u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+    u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+  }
+  for (int i = 0; i < 4; ++i) {
+    r[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+    r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+  }
+}
+
+__attribute__((target("avx2")))
+inline void transpose_epi64(__m256i r[4]) {
+  __m256i t0 = _mm256_unpacklo_epi64(r[0], r[1]), t1 = _mm256_unpackhi_epi64(r[0], r[1]);
+  __m256i t2 = _mm256_unpacklo_epi64(r[2], r[3]), t3 = _mm256_unpackhi_epi64(r[2], r[3]);
+  r[0] = _mm256_permute2x128_si256(t0, t2, 0x20);
+  r[1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+  r[2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+  r[3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+}
+
+// AVX2 has no 64 bit min or max, a compare and blend stands in
+__attribute__((target("avx2")))
+inline __m256i min_epi64(const __m256i &a, const __m256i &b) {
+  return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+}
+
+__attribute__((target("avx2")))
+inline __m256i max_epi64(const __m256i &a, const __m256i &b) {
+  return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(b, a));
+}
+
+// four consecutive keys widened to 64 bit lanes
+__attribute__((target("avx2")))
+inline __m256i load_epi64(const int64_t *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+__attribute__((target("avx2")))
+inline __m256i load_epi64(const int32_t *p) {
+  return _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+
+template<typename T>
+__attribute__((target("avx2")))
+SubSum<int64_t> sub_sum_avx2_epi64(const T *a, size_t n) {
+  size_t segment = n / 16 * 4;
+  __m256i prefix = _mm256_setzero_si256(), low = prefix, high = prefix, best = prefix;
+  for (size_t i = 0; i < segment; i += 4) {
+    __m256i r[4];
+    for (int l = 0; l < 4; ++l) {
+      r[l] = load_epi64(a + l * segment + i);
+    }
+    transpose_epi64(r);
+    for (int t = 0; t < 4; ++t) {
+      prefix = _mm256_add_epi64(prefix, r[t]);
+      low = min_epi64(low, prefix);
+      high = max_epi64(high, prefix);
+      best = max_epi64(best, _mm256_sub_epi64(prefix, low));
+    }
+  }
+  alignas(32) int64_t lanes[4][4];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[0]), prefix);
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[1]), low);
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[2]), high);
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[3]), best);
+  return combine(fold_lanes(lanes[0], lanes[1], lanes[2], lanes[3], 4),
+                 sub_sum_scalar(a + 4 * segment, n - 4 * segment));
+}
+
+__attribute__((target("avx2")))
+SubSum<int64_t> sub_sum_avx2(const int32_t *a, size_t n) {
+  return sub_sum_avx2_epi64(a, n);
+}
+
+__attribute__((target("avx2")))
+SubSum<int64_t> sub_sum_avx2(const int64_t *a, size_t n) {
+  return sub_sum_avx2_epi64(a, n);
+}
+
+__attribute__((target("avx2")))
+SubSum<float> sub_sum_avx2(const float *a, size_t n) {
+  size_t segment = n / 64 * 8;
+  __m256 prefix = _mm256_setzero_ps(), low = prefix, high = prefix, best = prefix;
+  for (size_t i = 0; i < segment; i += 8) {
+    __m256i r[8];
+    for (int l = 0; l < 8; ++l) {
+      r[l] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + l * segment + i));
+    }
+    transpose_epi32(r);
+    for (int t = 0; t < 8; ++t) {
+      prefix = _mm256_add_ps(prefix, _mm256_castsi256_ps(r[t]));
+      low = _mm256_min_ps(low, prefix);
+      high = _mm256_max_ps(high, prefix);
+      best = _mm256_max_ps(best, _mm256_sub_ps(prefix, low));
+    }
+  }
+  alignas(32) float lanes[4][8];
+  _mm256_store_ps(lanes[0], prefix);
+  _mm256_store_ps(lanes[1], low);
+  _mm256_store_ps(lanes[2], high);
+  _mm256_store_ps(lanes[3], best);
+  return combine(fold_lanes(lanes[0], lanes[1], lanes[2], lanes[3], 8),
+                 sub_sum_scalar(a + 8 * segment, n - 8 * segment));
+}
+
+__attribute__((target("avx2")))
+SubSum<double> sub_sum_avx2(const double *a, size_t n) {
+  size_t segment = n / 16 * 4;
+  __m256d prefix = _mm256_setzero_pd(), low = prefix, high = prefix, best = prefix;
+  for (size_t i = 0; i < segment; i += 4) {
+    __m256i r[4];
+    for (int l = 0; l < 4; ++l) {
+      r[l] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + l * segment + i));
+    }
+    transpose_epi64(r);
+    for (int t = 0; t < 4; ++t) {
+      prefix = _mm256_add_pd(prefix, _mm256_castsi256_pd(r[t]));
+      low = _mm256_min_pd(low, prefix);
+      high = _mm256_max_pd(high, prefix);
+      best = _mm256_max_pd(best, _mm256_sub_pd(prefix, low));
+    }
+  }
+  alignas(32) double lanes[4][4];
+  _mm256_store_pd(lanes[0], prefix);
+  _mm256_store_pd(lanes[1], low);
+  _mm256_store_pd(lanes[2], high);
+  _mm256_store_pd(lanes[3], best);
+  return combine(fold_lanes(lanes[0], lanes[1], lanes[2], lanes[3], 4),
+                 sub_sum_scalar(a + 4 * segment, n - 4 * segment));
+}
+
+#endif
+
+// Summary, and with max_sub_sum5 max_sub_sum4, for int32, int64, float and
+// double, on AVX2 when the running CPU has it. Integer results match
+// max_sub_sum4 exactly, floating point sums are added in a different order,
+// so they can differ from a scalar loop in the last bits.
+template<typename T>
+SubSum<SumType<T>> sub_sum(const T *a, size_t n) {
+#ifdef MAX_SUB_SUM_X86_SIMD
+  static const bool avx2 = has_avx2();
+  if (avx2) return sub_sum_avx2(a, n);
+#endif
+  return sub_sum_scalar(a, n);
+}
+
+template<typename T>
+T max_sub_sum5(const T *a, size_t n) {
+  return T(sub_sum(a, n).best);
+}
+
+template<typename T>
+T max_sub_sum5(const vector<T> &a) {
+  return max_sub_sum5(a.data(), a.size());
+}
+
+// Parallel max_sub_sum5: one contiguous chunk per worker thread (0 means one
+// per hardware thread), each summarized with sub_sum, then the summaries
+// folded in order. O(n / p) per thread plus O(p) for the fold. The fold runs
+// in SumType<T> too: chunk totals of int32 input overflow int32 long before
+// the answer does.
+template<typename T>
+T max_sub_sum6(const T *a, size_t n, size_t threads = 0) {
+  size_t workers = threads ? threads : max(1u, thread::hardware_concurrency());
+  workers = max(size_t(1), min(workers, n));
+  vector<SubSum<SumType<T>>> sums(workers);
+  auto job = [&](size_t w) {
+    size_t first = n * w / workers, last = n * (w + 1) / workers;
+    sums[w] = sub_sum(a + first, last - first);
+  };
+  vector<thread> pool;
+  for (size_t w = 1; w < workers; ++w) pool.emplace_back(job, w);
+  job(0);
+  for (auto &t : pool) t.join();
+  SubSum<SumType<T>> sum = sums[0];
+  for (size_t w = 1; w < workers; ++w) sum = combine(sum, sums[w]);
+  return T(sum.best);
+}
+
+template<typename T>
+T max_sub_sum6(const vector<T> &a, size_t threads = 0) {
+  return max_sub_sum6(a.data(), a.size(), threads);
+}
+
+// Max subarray over values that arrive in pieces: Add() takes chunks of any
+// size and best(), start() and end() describe the best a[start, end) seen
+// so far (start == end for the empty one), with O(1) state. The state is
+// max_sub_sum4's: the sum of the current run, reset to 0 where it would go
+// negative, so nothing grows with the length of the stream. Whole blocks
+// are summarized with sub_sum first and the per-element bookkeeping of
+// indices only runs on blocks that hold a new best or reset the run, short
+// chunks go straight to that scan.
+template<typename T>
+class MaxSubSumStream {
+
+public:
+  static const size_t kBlock = 4096;
+
+  MaxSubSumStream()
+  : count_(0), curr_(0), run_(0), best_(0), start_(0), end_(0) {}
+
+  void Add(const T *a, size_t n) {
+    for (size_t i = 0; i < n; i += kBlock) {
+      size_t m = min(kBlock, n - i);
+      if (m < 64) {
+        Scan(a + i, m);
+        continue;
+      }
+      auto sum = sub_sum(a + i, m);
+      // in the wide type, block totals can be far below the run
+      SumType<T> curr = curr_;
+      if (max(sum.best, curr + sum.prefix) > best_ || curr + (sum.total - sum.suffix) < 0) {
+        Scan(a + i, m);
+      } else {
+        curr_ = T(curr + sum.total);
+        count_ += m;
+      }
+    }
+  }
+
+  void Add(const T &x) {
+    Scan(&x, 1);
+  }
+
+  // whitespace separated values until the end of in, e.g. Read(cin);
+  // returns how many were read
+  size_t Read(istream &in) {
+    T buffer[1024];
+    size_t total = 0, n = 0;
+    while (in >> buffer[n]) {
+      if (++n == 1024) {
+        Add(buffer, n);
+        total += n;
+        n = 0;
+      }
+    }
+    Add(buffer, n);
+    return total + n;
+  }
+
+  T best() const { return best_; }
+  size_t start() const { return start_; }
+  size_t end() const { return end_; }
+  size_t size() const { return count_; }
+
+private:
+  size_t count_;
+  // sum of a[run_, count_), never negative and never above best_
+  T curr_;
+  size_t run_;
+  T best_;
+  size_t start_;
+  size_t end_;
+
+  void Scan(const T *a, const size_t &n) {
+    for (size_t i = 0; i < n; ++i) {
+      curr_ += a[i];
+      ++count_;
+      if (curr_ > best_) {
+        best_ = curr_;
+        start_ = run_;
+        end_ = count_;
+      } else if (curr_ < 0) {
+        curr_ = 0;
+        run_ = count_;
+      }
+    }
+  }
+
+};
+
+template<typename T>
+const size_t MaxSubSumStream<T>::kBlock;
+
+// Feeds a file of raw T values to stream: mapped where mmap exists, read
+// through a fixed buffer otherwise, never copied whole
+template<typename T>
+void max_sub_sum_file(const string &path, MaxSubSumStream<T> &stream) {
+#ifdef MAX_SUB_SUM_MMAP
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw runtime_error("max_sub_sum_file: cannot open " + path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw runtime_error("max_sub_sum_file: cannot stat " + path);
+  }
+  size_t length = size_t(st.st_size);
+  if (length >= sizeof(T)) {
+    void *p = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+      close(fd);
+      throw runtime_error("max_sub_sum_file: cannot map " + path);
+    }
+    // one pass front to back, let the kernel read ahead
+    madvise(p, length, MADV_SEQUENTIAL);
+    stream.Add(static_cast<const T *>(p), length / sizeof(T));
+    munmap(p, length);
+  }
+  close(fd);
+#else
+  ifstream in(path, ios::binary);
+  if (!in) {
+    throw runtime_error("max_sub_sum_file: cannot open " + path);
+  }
+  vector<T> buffer(1 << 16);
+  while (in.read(reinterpret_cast<char *>(buffer.data()), buffer.size() * sizeof(T)) || in.gcount()) {
+    stream.Add(buffer.data(), size_t(in.gcount()) / sizeof(T));
+  }
+#endif
+}
+
 // -2, 11, -4, 13, -5, -2 => 20
 // 4, -3, 5, -2, -1, 2, 6, -2 => 11
 
@@ -106,3 +526,273 @@ TEST_CASE( "max subsequence sum 4" ) {
   REQUIRE(max_sub_sum4({ -2, 11, -4, 13, -5, -2 }) == 20);
   REQUIRE(max_sub_sum4({ 4, -3, 5, -2, -1, 2, 6, -2 }) == 11);
 }
+
+TEST_CASE( "max subsequence sum 5" ) {
+  REQUIRE(max_sub_sum5(vector<int>{ -2, 11, -4, 13, -5, -2 }) == 20);
+  REQUIRE(max_sub_sum5(vector<int>{ 4, -3, 5, -2, -1, 2, 6, -2 }) == 11);
+  REQUIRE(max_sub_sum5(vector<int>{}) == 0);
+  REQUIRE(max_sub_sum5(vector<double>{ -1.5, -0.5 }) == 0);
+
+  mt19937 gen(5);
+  for (int n = 0; n < 200; ++n) {
+    for (int spread : { 3, 100, 1000000 }) {
+      uniform_int_distribution<> dist(-spread, spread / 2);
+      vector<int> a(n);
+      for (auto &x : a) x = dist(gen);
+      int expect = max_sub_sum4(a);
+      REQUIRE(max_sub_sum_scalar(a.data(), a.size()) == expect);
+      REQUIRE(max_sub_sum5(vector<int32_t>(a.begin(), a.end())) == expect);
+      REQUIRE(max_sub_sum5(vector<int64_t>(a.begin(), a.end())) == expect);
+      REQUIRE(max_sub_sum5(vector<double>(a.begin(), a.end())) == expect);
+      if (spread < 1000000) {
+        REQUIRE(max_sub_sum5(vector<float>(a.begin(), a.end())) == expect);
+      }
+    }
+  }
+  vector<int> big(100003);
+  uniform_int_distribution<> dist(-1000, 990);
+  for (auto &x : big) x = dist(gen);
+  REQUIRE(max_sub_sum5(big) == max_sub_sum4(big));
+  REQUIRE(max_sub_sum5(vector<int64_t>(big.begin(), big.end())) == max_sub_sum4(big));
+  REQUIRE(max_sub_sum5(vector<double>(big.begin(), big.end())) == max_sub_sum4(big));
+
+  vector<int64_t> wide { 3000000000LL, -1, 3000000000LL, -7000000000LL, 5 };
+  REQUIRE(max_sub_sum5(wide) == 5999999999LL);
+
+  // prefix sums drift far below INT_MIN while the answer stays small
+  for (size_t n : { size_t(63), size_t(100000), size_t(3000000) }) {
+    vector<int> drift(n, -1000);
+    drift.push_back(7);
+    drift.insert(drift.begin() + long(n / 2), 5);
+    REQUIRE(max_sub_sum4(drift) == 7);
+    REQUIRE(max_sub_sum_scalar(drift.data(), drift.size()) == 7);
+    REQUIRE(max_sub_sum5(drift) == 7);
+  }
+  vector<int> extremes;
+  for (int i = 0; i < 1000; ++i) {
+    extremes.push_back(numeric_limits<int>::min());
+    extremes.push_back(i % 3 ? numeric_limits<int>::max() : 1);
+  }
+  REQUIRE(max_sub_sum5(extremes) == max_sub_sum4(extremes));
+}
+
+TEST_CASE( "max subsequence sum 6" ) {
+  REQUIRE(max_sub_sum6(vector<int>{ -2, 11, -4, 13, -5, -2 }, 2) == 20);
+  REQUIRE(max_sub_sum6(vector<int>{ 4, -3, 5, -2, -1, 2, 6, -2 }, 3) == 11);
+  REQUIRE(max_sub_sum6(vector<int>{}) == 0);
+  REQUIRE(max_sub_sum6(vector<int>{ -3 }, 4) == 0);
+
+  // any split folds to the same summary as the whole
+  mt19937 gen(6);
+  uniform_int_distribution<> dist(-100, 60);
+  vector<int> a(300);
+  for (auto &x : a) x = dist(gen);
+  auto whole = sub_sum_scalar(a.data(), a.size());
+  for (size_t cut = 0; cut <= a.size(); cut += 7) {
+    auto sum = combine(sub_sum_scalar(a.data(), cut), sub_sum_scalar(a.data() + cut, a.size() - cut));
+    REQUIRE(sum.total == whole.total);
+    REQUIRE(sum.prefix == whole.prefix);
+    REQUIRE(sum.suffix == whole.suffix);
+    REQUIRE(sum.best == whole.best);
+  }
+
+  for (int n : { 1, 5, 64, 1000, 100003 }) {
+    vector<int> b(n);
+    for (auto &x : b) x = dist(gen);
+    for (size_t threads : { 1, 2, 3, 7, 64 }) {
+      REQUIRE(max_sub_sum6(b, threads) == max_sub_sum4(b));
+      REQUIRE(max_sub_sum6(vector<int64_t>(b.begin(), b.end()), threads) == max_sub_sum4(b));
+    }
+  }
+
+  // every chunk total is far below INT_MIN, the answer is not
+  vector<int> drift(5000000, -1000);
+  drift[1234567] = 900;
+  drift.push_back(7);
+  REQUIRE(max_sub_sum4(drift) == 900);
+  for (size_t threads : { 1, 2, 3, 4, 8 }) {
+    REQUIRE(max_sub_sum6(drift, threads) == 900);
+  }
+  auto halves = combine(sub_sum(drift.data(), 2500000), sub_sum(drift.data() + 2500000, drift.size() - 2500000));
+  REQUIRE(halves.total == -4999999LL * 1000 + 900 + 7);
+  REQUIRE(halves.suffix == 7);
+}
+
+TEST_CASE( "max subsequence sum stream" ) {
+  MaxSubSumStream<int> stream;
+  REQUIRE(stream.best() == 0);
+  REQUIRE(stream.start() == stream.end());
+  vector<int> a { -2, 11, -4, 13, -5, -2 };
+  stream.Add(a.data(), 2);
+  REQUIRE(stream.best() == 11);
+  stream.Add(a[2]);
+  stream.Add(a.data() + 3, 3);
+  REQUIRE(stream.best() == 20);
+  REQUIRE(stream.start() == 1);
+  REQUIRE(stream.end() == 4);
+  REQUIRE(stream.size() == 6);
+
+  mt19937 gen(8);
+  uniform_int_distribution<> dist(-100, 95);
+  for (int n : { 0, 1, 100, 5000, 100000 }) {
+    vector<int> b(n);
+    for (auto &x : b) x = dist(gen);
+    MaxSubSumStream<int> chunks;
+    for (size_t i = 0; i < b.size();) {
+      size_t m = min(b.size() - i, size_t(gen() % 9000));
+      chunks.Add(b.data() + i, m);
+      i += m;
+    }
+    REQUIRE(chunks.size() == b.size());
+    REQUIRE(chunks.best() == max_sub_sum4(b));
+    REQUIRE(accumulate(b.begin() + long(chunks.start()), b.begin() + long(chunks.end()), 0) == chunks.best());
+
+    ostringstream text;
+    for (auto x : b) text << x << "\n";
+    istringstream in(text.str());
+    MaxSubSumStream<int> parsed;
+    REQUIRE(parsed.Read(in) == b.size());
+    REQUIRE(parsed.best() == chunks.best());
+    REQUIRE(parsed.start() == chunks.start());
+    REQUIRE(parsed.end() == chunks.end());
+
+    const string path = "max_sub_sum_stream_test.bin";
+    {
+      ofstream out(path, ios::binary);
+      out.write(reinterpret_cast<const char *>(b.data()), long(b.size() * sizeof(int)));
+    }
+    MaxSubSumStream<int> file;
+    max_sub_sum_file(path, file);
+    remove(path.c_str());
+    REQUIRE(file.best() == chunks.best());
+    REQUIRE(file.start() == chunks.start());
+    REQUIRE(file.end() == chunks.end());
+  }
+  MaxSubSumStream<int> missing;
+  REQUIRE_THROWS(max_sub_sum_file("max_sub_sum_no_such_file.bin", missing));
+
+  // the prefix sums drift far below INT_MIN, the state must not
+  vector<int> drift(3000000, -1000);
+  drift[2000000] = 900;
+  drift.push_back(7);
+  MaxSubSumStream<int> blocks, single;
+  for (size_t i = 0; i < drift.size();) {
+    size_t m = min(drift.size() - i, size_t(gen() % 20000));
+    blocks.Add(drift.data() + i, m);
+    i += m;
+  }
+  for (auto x : drift) single.Add(x);
+  for (auto *fed : { &blocks, &single }) {
+    REQUIRE(fed->best() == 900);
+    REQUIRE(fed->start() == 2000000);
+    REQUIRE(fed->end() == 2000001);
+    REQUIRE(fed->size() == drift.size());
+  }
+}
+
+//
+// ====== benchmarks ======================
+// hidden from the default run, use `max_sub_sum [benchmark]`
+//
+
+template<typename F>
+double ms(F f) {
+  auto start = chrono::steady_clock::now();
+  f();
+  auto end = chrono::steady_clock::now();
+  return chrono::duration<double, milli>(end - start).count();
+}
+
+// max_sub_sum4 only takes ints, -1 for the other types
+double max_sub_sum4_ms(const vector<int> &a, const int &expect) {
+  int result = 0;
+  double t = ms([&] { result = max_sub_sum4(a); });
+  CHECK(result == expect);
+  return t;
+}
+
+template<typename T>
+double max_sub_sum4_ms(const vector<T> &, const T &) {
+  return -1;
+}
+
+// random values, sizes stop at 10^9 elements or 2 GB, whichever comes first
+template<typename T>
+void benchmark_max_sub_sum(const char *type) {
+  for (size_t n = 1000000; n <= 1000000000 && n * sizeof(T) <= (size_t(2) << 30); n *= 10) {
+    vector<T> a(n);
+    mt19937 gen(7);
+    uniform_int_distribution<> dist(-1000, 999);
+    for (auto &x : a) x = T(dist(gen));
+    T scalar = 0, simd = 0;
+    double t_scalar = ms([&] { scalar = max_sub_sum_scalar(a.data(), a.size()); });
+    double t_simd = ms([&] { simd = max_sub_sum5(a); });
+    cout << type << "\t" << n << "\t" << max_sub_sum4_ms(a, scalar) << "\t"
+         << t_scalar << "\t" << t_simd << endl;
+    if (is_integral<T>::value) {
+      CHECK(simd == scalar);
+    } else {
+      // float sums over millions of elements round differently per order
+      CHECK(double(simd) == Approx(double(scalar)).epsilon(1e-3));
+    }
+  }
+}
+
+TEST_CASE( "benchmark max subsequence sum 5", "[.][benchmark]" ) {
+  cout << "type\tn\tmax_sub_sum4 ms\tscalar ms\tmax_sub_sum5 ms" << endl;
+  benchmark_max_sub_sum<int32_t>("int32");
+  benchmark_max_sub_sum<int64_t>("int64");
+  benchmark_max_sub_sum<float>("float");
+  benchmark_max_sub_sum<double>("double");
+}
+
+TEST_CASE( "benchmark max subsequence sum 6", "[.][benchmark]" ) {
+  unsigned cores = max(1u, thread::hardware_concurrency());
+  cout << "n\tthreads\tmax_sub_sum4 ms\tmax_sub_sum5 ms\tmax_sub_sum6 ms\tGB/s" << endl;
+  // int32 up to 2 GB
+  for (size_t n = 10000000; n <= 500000000; n *= 50) {
+    vector<int> a(n);
+    mt19937 gen(7);
+    uniform_int_distribution<> dist(-1000, 999);
+    for (auto &x : a) x = dist(gen);
+    int r4 = 0, r5 = 0;
+    double t4 = ms([&] { r4 = max_sub_sum4(a); });
+    double t5 = ms([&] { r5 = max_sub_sum5(a); });
+    CHECK(r4 == r5);
+    for (size_t threads = 1; threads <= cores; threads *= 2) {
+      int r6 = 0;
+      double t6 = ms([&] { r6 = max_sub_sum6(a, threads); });
+      CHECK(r6 == r4);
+      cout << n << "\t" << threads << "\t" << t4 << "\t" << t5 << "\t" << t6 << "\t"
+           << n * sizeof(int) / t6 / 1e6 << endl;
+    }
+  }
+}
+
+TEST_CASE( "benchmark max subsequence sum stream", "[.][benchmark]" ) {
+  cout << "n\tchunk\tmax_sub_sum4 ms\tstream ms\tfile ms" << endl;
+  const size_t n = 100000000;
+  vector<int> a(n);
+  mt19937 gen(7);
+  uniform_int_distribution<> dist(-1000, 999);
+  for (auto &x : a) x = dist(gen);
+  const string path = "max_sub_sum_stream_benchmark.bin";
+  {
+    ofstream out(path, ios::binary);
+    out.write(reinterpret_cast<const char *>(a.data()), long(n * sizeof(int)));
+  }
+  int r4 = 0;
+  double t4 = ms([&] { r4 = max_sub_sum4(a); });
+  for (size_t chunk : { size_t(1), size_t(100), size_t(1) << 16 }) {
+    MaxSubSumStream<int> stream, file;
+    double t = ms([&] {
+      for (size_t i = 0; i < n; i += chunk) stream.Add(a.data() + i, min(chunk, n - i));
+    });
+    double tf = ms([&] { max_sub_sum_file(path, file); });
+    CHECK(stream.best() == r4);
+    CHECK(file.best() == r4);
+    cout << n << "\t" << chunk << "\t" << t4 << "\t" << t << "\t" << tf << endl;
+  }
+  remove(path.c_str());
+}
+